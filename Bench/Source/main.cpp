@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ *
+ * Microbenchmarks for the hot serialization and image paths. Every benchmark prints one JSON
+ * object per line to stdout, so results can be collected across releases and diffed by scripts:
+ *
+ *   {"bench": "...", "params": {...}, "iters": N, "nsPerOp": X, "mbPerS": Y}
+ *
+ * The numbers are not meant to be comparable across machines, only across revisions on the same
+ * machine.
+ */
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <boost/lockfree/spsc_queue.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ImageDiff.hpp"
+#include "Message.hpp"
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+namespace e47 {
+namespace Bench {
+
+void report(const String& name, const json& params, uint64 iters, double seconds, double bytesPerIter) {
+    json j = {{"bench", name.toStdString()}, {"params", params}, {"iters", iters}, {"nsPerOp", seconds * 1e9 / iters}};
+    if (bytesPerIter > 0) {
+        j["mbPerS"] = bytesPerIter * iters / seconds / (1024 * 1024);
+    }
+    std::cout << j.dump() << std::endl;
+}
+
+// Runs fn in a loop, growing the iteration count until one measurement covers ~0.5s, then reports
+// the last (longest) run. The warmup runs double as cache/branch predictor priming.
+template <typename Fn>
+void run(const String& name, const json& params, double bytesPerIter, Fn&& fn) {
+    uint64 iters = 1;
+    for (;;) {
+        auto start = Time::getHighResolutionTicks();
+        for (uint64 i = 0; i < iters; i++) {
+            fn();
+        }
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+        if (seconds >= 0.5 || iters >= (1ull << 30)) {
+            report(name, params, iters, seconds, bytesPerIter);
+            return;
+        }
+        iters = seconds < 0.005 ? iters * 10 : static_cast<uint64>(iters * (0.6 / seconds)) + 1;
+    }
+}
+
+// Serialize/deserialize round trip of one audio block through a shared memory ring. The slot
+// carries the identical byte layout as the socket stream, so this measures the pure
+// serialization cost of the TCP path as well, minus the syscalls.
+void benchAudioMessage() {
+    for (int channels : {2, 8, 16}) {
+        for (int samples : {64, 256, 1024}) {
+            SharedMemoryRing ring;
+            String shmName;
+            shmName << "/ag.bench." << channels << "." << samples;
+            uint32_t slotSize =
+                static_cast<uint32_t>(sizeof(AudioMessage::RequestHeader) + sizeof(AudioPlayHead::CurrentPositionInfo) +
+                                      (size_t)channels * samples * sizeof(float) + 8192);
+            if (!ring.create(shmName, slotSize, 2)) {
+                std::cerr << "failed to create shared memory ring" << std::endl;
+                return;
+            }
+            AudioMessage sender, receiver;
+            AudioBuffer<float> buffer(channels, samples), bufferF;
+            AudioBuffer<double> bufferD;
+            MidiBuffer midi, midiOut;
+            AudioPlayHead::CurrentPositionInfo posInfo, posInfoOut;
+            posInfo.resetToDefault();
+            posInfoOut.resetToDefault();
+            Random rnd(1);
+            for (int chan = 0; chan < channels; chan++) {
+                auto* dst = buffer.getWritePointer(chan);
+                for (int s = 0; s < samples; s++) {
+                    dst[s] = rnd.nextFloat() * 2 - 1;
+                }
+            }
+            for (int ev = 0; ev < 4; ev++) {
+                midi.addEvent(MidiMessage::noteOn(1, 60 + ev, (uint8)100), ev);
+            }
+            double bytes = (double)channels * samples * sizeof(float);
+            run("audiomessage-roundtrip", {{"channels", channels}, {"samples", samples}}, bytes, [&] {
+                sender.sendToServer(ring, buffer, midi, posInfo);
+                receiver.readFromClient(ring, bufferF, bufferD, midiOut, posInfoOut);
+            });
+            ring.close();
+        }
+    }
+}
+
+// The screen channel kernels across typical editor and full screen resolutions, with ~10% of the
+// pixels changed between the frames.
+void benchImageDiff() {
+    struct Res {
+        int width, height;
+    };
+    for (auto res : {Res{640, 480}, Res{1024, 768}, Res{1920, 1080}}) {
+        std::size_t numPx = (std::size_t)res.width * res.height;
+        std::size_t bytes = numPx * sizeof(PixelARGB);
+        std::vector<uint8_t> from(bytes), to(bytes), delta(bytes);
+        Random rnd(2);
+        for (auto& b : to) {
+            b = (uint8_t)rnd.nextInt(256);
+        }
+        from = to;
+        auto* px = reinterpret_cast<uint32_t*>(to.data());
+        for (std::size_t i = 0; i < numPx / 10; i++) {
+            px[(std::size_t)rnd.nextInt((int)numPx)] ^= 0x00ffffff;
+        }
+        json params = {{"width", res.width}, {"height", res.height}};
+        float brightness;
+        run("imagediff-getdelta", params, (double)bytes, [&] {
+            ImageDiff::getDelta(from.data(), to.data(), delta.data(), res.width, res.height, &brightness);
+        });
+        std::vector<bool> dirtyTiles;
+        run("imagediff-getdirtytiles", params, (double)bytes, [&] {
+            ImageDiff::getDirtyTiles(from.data(), to.data(), res.width, res.height, dirtyTiles, &brightness);
+        });
+        run("imagediff-applydelta", params, (double)bytes,
+            [&] { ImageDiff::applyDelta(from.data(), delta.data(), res.width, res.height); });
+    }
+}
+
+// Payload buffer management: setData measures the plain copy path (compression off, zlib would
+// dominate the numbers), the resize benchmark alternates between a small and a large size, so
+// every call goes through the resize/realign path.
+void benchPayload() {
+    for (int size : {1024, 64 * 1024, 1024 * 1024}) {
+        std::vector<char> src((std::size_t)size, 'x');
+        BinaryPayload pld(0);
+        pld.allowCompression = false;
+        run("payload-setdata", {{"bytes", size}}, (double)size, [&] { pld.setData(src.data(), size); });
+    }
+    BinaryPayload pld(0);
+    pld.allowCompression = false;
+    bool big = false;
+    run("payload-resize", {{"small", 1024}, {"large", 1024 * 1024}}, 0, [&] {
+        pld.setSize(big ? 1024 * 1024 : 1024);
+        big = !big;
+    });
+}
+
+// The spsc queue handoff as used by the streamer: a producer and a consumer thread exchanging
+// audio blocks through a small queue. The element copy includes the deep copy of the audio
+// buffer, which is the actual per block cost in AudioStreamer. The uncontended variant isolates
+// the queue mechanics on a single thread.
+void benchSpscQueue() {
+    struct Block {
+        AudioBuffer<float> audio;
+        MidiBuffer midi;
+    };
+    constexpr uint64 OPS = 1 << 17;
+    constexpr int CAPACITY = 16;
+    for (int samples : {64, 512}) {
+        boost::lockfree::spsc_queue<Block> q(CAPACITY);
+        Block block;
+        block.audio.setSize(2, samples);
+        block.audio.clear();
+        std::thread consumer([&q] {
+            Block out;
+            uint64 popped = 0;
+            while (popped < OPS) {
+                if (q.pop(out)) {
+                    popped++;
+                }
+            }
+        });
+        auto start = Time::getHighResolutionTicks();
+        for (uint64 i = 0; i < OPS;) {
+            if (q.push(block)) {
+                i++;
+            }
+        }
+        consumer.join();
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+        report("spsc-handoff", {{"capacity", CAPACITY}, {"channels", 2}, {"samples", samples}}, OPS, seconds,
+               (double)2 * samples * sizeof(float));
+    }
+    boost::lockfree::spsc_queue<uint64> q(CAPACITY);
+    uint64 v;
+    run("spsc-pushpop", {{"capacity", CAPACITY}}, 0, [&] {
+        q.push(1);
+        q.pop(v);
+    });
+}
+
+}  // namespace Bench
+}  // namespace e47
+
+int main() {
+    e47::Bench::benchAudioMessage();
+    e47::Bench::benchImageDiff();
+    e47::Bench::benchPayload();
+    e47::Bench::benchSpscQueue();
+    return 0;
+}
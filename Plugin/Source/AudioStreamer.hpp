@@ -15,17 +15,126 @@ class AudioStreamer : public Thread {
         AudioBuffer<T> audio;
         MidiBuffer midi;
         AudioPlayHead::CurrentPositionInfo posInfo;
+        // the server replies in the precision of the request block, so the flag has to travel
+        // with the block from send to read
+        bool wireIsFloat = false;
+        // send timestamp (Time::getMillisecondCounterHiRes), lets the reader judge the age of a
+        // block after the round trip, 0 for the initial queue credits
+        double enqueuedAt = 0.0;
     };
 
     Client* client;
     StreamingSocket* socket;
-    boost::lockfree::spsc_queue<AudioMidiBuffer> writeQ, readQ;
-    std::mutex writeMtx, readMtx;
-    std::condition_variable writeCv, readCv;
+    boost::lockfree::spsc_queue<AudioMidiBuffer> writeQ, readQ, transitQ, poolQ;
+    std::mutex writeMtx, readMtx, transitMtx;
+    std::condition_variable writeCv, readCv, transitCv;
 
-    AudioMidiBuffer workingSendBuf, workingReadBuf;
-    int workingSendSamples = 0;
-    int workingReadSamples = 0;
+    // Circular FIFO for adapting mismatched host/server block sizes. Accumulation and drain are
+    // O(1) index arithmetic plus at most two span copies per channel, no per-sample copying and no
+    // reallocation on the audio thread in the steady state.
+    struct WorkingBuffer {
+        AudioBuffer<T> audio;
+        MidiBuffer midi;
+        int readPos = 0;
+        int samples = 0;
+
+        void setCapacity(int channels, int capacity) {
+            audio.setSize(channels, capacity);
+            audio.clear();
+            readPos = 0;
+            samples = 0;
+        }
+
+        void push(AudioBuffer<T>& src, MidiBuffer& srcMidi) {
+            int num = src.getNumSamples();
+            if (audio.getNumSamples() - samples < num) {
+                grow(src.getNumChannels(), samples + num);
+            }
+            int capacity = audio.getNumSamples();
+            int writePos = readPos + samples;
+            if (writePos >= capacity) {
+                writePos -= capacity;
+            }
+            int firstSpan = jmin(num, capacity - writePos);
+            for (int chan = 0; chan < src.getNumChannels(); chan++) {
+                audio.copyFrom(chan, writePos, src, chan, 0, firstSpan);
+                if (firstSpan < num) {
+                    audio.copyFrom(chan, 0, src, chan, firstSpan, num - firstSpan);
+                }
+            }
+            samples += num;
+            midi.addEvents(srcMidi, 0, srcMidi.getNumEvents(), 0);
+        }
+
+        // drops samples without copying them anywhere
+        void skip(int num) {
+            readPos += num;
+            if (readPos >= audio.getNumSamples()) {
+                readPos -= audio.getNumSamples();
+            }
+            samples -= num;
+        }
+
+        void pop(AudioBuffer<T>& dst, int num) {
+            int capacity = audio.getNumSamples();
+            int firstSpan = jmin(num, capacity - readPos);
+            for (int chan = 0; chan < dst.getNumChannels(); chan++) {
+                dst.copyFrom(chan, 0, audio, chan, readPos, firstSpan);
+                if (firstSpan < num) {
+                    dst.copyFrom(chan, firstSpan, audio, chan, 0, num - firstSpan);
+                }
+            }
+            readPos += num;
+            if (readPos >= capacity) {
+                readPos -= capacity;
+            }
+            samples -= num;
+        }
+
+      private:
+        // rare path, only hit when the host grows its block size
+        void grow(int channels, int minCapacity) {
+            AudioBuffer<T> bigger(jmax(channels, audio.getNumChannels()),
+                                  jmax(minCapacity, audio.getNumSamples()) * 2);
+            int capacity = audio.getNumSamples();
+            int firstSpan = jmin(samples, capacity - readPos);
+            for (int chan = 0; chan < audio.getNumChannels(); chan++) {
+                bigger.copyFrom(chan, 0, audio, chan, readPos, firstSpan);
+                if (firstSpan < samples) {
+                    bigger.copyFrom(chan, firstSpan, audio, chan, 0, samples - firstSpan);
+                }
+            }
+            audio = std::move(bigger);
+            readPos = 0;
+        }
+    };
+
+    WorkingBuffer workingSendBuf, workingReadBuf;
+
+    // one message instance per direction, they carry transport state (UDP sequence numbers,
+    // reordering window) across blocks and run on different threads
+    AudioMessage sendMsg, readMsg;
+
+    // request stream recorder, active when the plugin config sets CaptureStream (see Replay)
+    std::unique_ptr<StreamCapture> capture;
+
+    // staging buffers for the precision downgrade, one per thread (sender/receiver)
+    AudioBuffer<float> wireSendBuf, wireReadBuf;
+
+    // blocks owed to the stream after missed deadlines, drained by dropping stale blocks
+    int readsBehind = 0;
+
+    // State of the jitter controller (see adapt()): the effective pipelining depth follows the
+    // measured fill level of the read queue instead of the static NumberOfBuffers guess.
+    int effBuffers;
+    int adaptBlocks = 0;
+    int adaptMinFill = 0;
+    int adaptUnderruns = 0;
+    static constexpr int ADAPT_WINDOW_BLOCKS = 512;
+
+    // Pipelining window for this connection. Every buffer in the pool/read queues is a credit to
+    // put one more block in flight; offline renders run with a much wider window than realtime.
+    int numBuffers;
 
     std::atomic_bool error{false};
 
@@ -33,22 +142,59 @@ class AudioStreamer : public Thread {
         : Thread("AudioStreamer"),
           client(clnt),
           socket(sock),
-          writeQ(clnt->NUM_OF_BUFFERS * 2),
-          readQ(clnt->NUM_OF_BUFFERS * 2) {
-        for (int i = 0; i < clnt->NUM_OF_BUFFERS; i++) {
+          writeQ(clnt->getNumBuffers() * 2),
+          readQ(clnt->getNumBuffers() * 2),
+          transitQ(clnt->getNumBuffers() * 2),
+          poolQ(clnt->getNumBuffers() * 2),
+          effBuffers(clnt->getNumBuffers()),
+          adaptMinFill(clnt->getNumBuffers() * 2),
+          numBuffers(clnt->getNumBuffers()),
+          receiver(this) {
+        clnt->m_effBuffers = numBuffers > 1 && !clnt->m_nonRealtime ? numBuffers : 0;
+        for (int i = 0; i < numBuffers; i++) {
             AudioMidiBuffer buf;
             buf.audio.setSize(clnt->m_channels, clnt->m_samplesPerBlock);
             buf.audio.clear();
             readQ.push(std::move(buf));
         }
-        workingSendBuf.audio.clear();
-        workingReadBuf.audio.clear();
+        // pre-size the send side as well, so the hot path does not allocate
+        for (int i = 0; i < numBuffers; i++) {
+            AudioMidiBuffer buf;
+            buf.audio.setSize(clnt->m_channels, clnt->m_samplesPerBlock);
+            buf.audio.clear();
+            poolQ.push(std::move(buf));
+        }
+        workingSendBuf.setCapacity(clnt->m_channels, clnt->m_samplesPerBlock * 2);
+        workingReadBuf.setCapacity(clnt->m_channels, clnt->m_samplesPerBlock * 2);
+        sendMsg.setWireFlags(clnt->m_audioFlags);
+        readMsg.setWireFlags(clnt->m_audioFlags);
+        if (nullptr != clnt->m_audio_udp) {
+            sendMsg.setUdpPeer(clnt->m_udpPeerHost, clnt->m_udpPeerPort);
+        }
+        if (clnt->m_captureStreamPath.isNotEmpty()) {
+            auto cap = std::make_unique<StreamCapture>();
+            String capFile = clnt->m_captureStreamPath + "." + String(clnt->m_clientPort) + ".agcap";
+            if (cap->open(capFile, clnt->m_channels, clnt->m_rate, clnt->m_samplesPerBlock)) {
+                logln_clnt(clnt, "capturing audio request stream to " << capFile);
+                capture = std::move(cap);
+                sendMsg.setCapture(capture.get());
+            } else {
+                logln_clnt(clnt, "failed to open stream capture " << capFile);
+            }
+        }
+        if (numBuffers > 1) {
+            receiver.startThread(Thread::realtimeAudioPriority);
+        }
     }
 
     ~AudioStreamer() {
+        client->m_effBuffers = 0;
         signalThreadShouldExit();
+        receiver.signalThreadShouldExit();
         notifyWrite();
         notifyRead();
+        notifyTransit();
+        receiver.stopThread(100);
         stopThread(100);
     }
 
@@ -58,6 +204,7 @@ class AudioStreamer : public Thread {
         client->m_error = true;
         notifyRead();
         notifyWrite();
+        notifyTransit();
     }
     void notifyWrite() {
         std::lock_guard<std::mutex> lock(writeMtx);
@@ -79,31 +226,61 @@ class AudioStreamer : public Thread {
         readCv.notify_one();
     }
 
-    bool waitRead() {
-        if (client->NUM_OF_BUFFERS > 1 && readQ.read_available() < (client->NUM_OF_BUFFERS / 2) &&
-            readQ.read_available() > 0) {
+    void notifyTransit() {
+        std::lock_guard<std::mutex> lock(transitMtx);
+        transitCv.notify_one();
+    }
+
+    void waitTransit() {
+        if (transitQ.read_available() == 0 && !error && !Thread::currentThreadShouldExit()) {
+            std::unique_lock<std::mutex> lock(transitMtx);
+            try {
+                transitCv.wait(lock,
+                               [this] { return transitQ.read_available() > 0 || receiver.threadShouldExit() || error; });
+            } catch (...) {
+            }
+        }
+    }
+
+    // Waits for a processed block. A deadline of 0 waits forever; otherwise it is an absolute
+    // timestamp (Time::getMillisecondCounterHiRes) after which false is returned, so the caller
+    // keeps a bounded worst-case cost on the DAW audio thread.
+    bool waitRead(double deadline = 0.0) {
+        // a drained queue is the expected state while bouncing, the DAW runs ahead of the server
+        bool offline = client->m_nonRealtime;
+        if (numBuffers > 1 && !offline && readQ.read_available() < (numBuffers / 2) && readQ.read_available() > 0) {
             logln_clnt(client, "warning: instance (" << client->getLoadedPluginsString()
                                                      << "): input buffer below 50% (" << readQ.read_available() << "/"
-                                                     << client->NUM_OF_BUFFERS << ")");
+                                                     << numBuffers << ")");
         } else if (readQ.read_available() == 0) {
-            if (client->NUM_OF_BUFFERS > 1) {
-                logln_clnt(client,
-                           "warning: instance ("
-                               << client->getLoadedPluginsString()
-                               << "): read queue empty, waiting for data, try increasing the NumberOfBuffers value");
+            if (numBuffers > 1 && !offline) {
+                logln_clnt(client, "warning: instance (" << client->getLoadedPluginsString()
+                                                         << "): read queue empty, waiting for data");
             }
             if (!error && !threadShouldExit()) {
                 std::unique_lock<std::mutex> lock(readMtx);
                 try {
-                    readCv.wait(lock, [this] { return readQ.read_available() > 0 || threadShouldExit(); });
+                    if (deadline > 0) {
+                        auto now = Time::getMillisecondCounterHiRes();
+                        if (now >= deadline ||
+                            !readCv.wait_for(lock, std::chrono::duration<double, std::milli>(deadline - now),
+                                             [this] { return readQ.read_available() > 0 || threadShouldExit(); })) {
+                            return false;
+                        }
+                    } else {
+                        readCv.wait(lock, [this] { return readQ.read_available() > 0 || threadShouldExit(); });
+                    }
                 } catch (...) {
                     return false;
                 }
             }
         }
-        return true;
+        return deadline <= 0 || readQ.read_available() > 0;
     }
 
+    // Sender loop: pushes queued blocks to the server as fast as they arrive. Reading the processed
+    // blocks back happens concurrently on the receiver thread, so block N+1 is already in flight
+    // while the server still works on block N.
     void run() {
         while (!currentThreadShouldExit() && !error && socket->isConnected()) {
             while (writeQ.read_available() > 0) {
@@ -114,60 +291,102 @@ class AudioStreamer : public Thread {
                     setError();
                     return;
                 }
-                MessageHelper::Error err;
-                if (!readReal(buf, &err)) {
-                    logln_clnt(client, "error: instance (" << client->getLoadedPluginsString()
-                                                           << "): read failed, error code " << err);
-                    setError();
-                    return;
-                }
-                readQ.push(std::move(buf));
-                notifyRead();
+                transitQ.push(std::move(buf));
+                notifyTransit();
             }
             waitWrite();
         }
     }
 
+    class Receiver : public Thread {
+      public:
+        Receiver(AudioStreamer* s) : Thread("AudioStreamerReceiver"), m_streamer(s) {}
+
+        void run() override {
+            auto* streamer = m_streamer;
+            auto* client = streamer->client;
+            while (!currentThreadShouldExit() && !streamer->error && streamer->socket->isConnected()) {
+                while (streamer->transitQ.read_available() > 0) {
+                    AudioMidiBuffer buf;
+                    streamer->transitQ.pop(buf);
+                    MessageHelper::Error err;
+                    if (!streamer->readReal(buf, &err)) {
+                        logln_clnt(client, "error: instance (" << client->getLoadedPluginsString()
+                                                               << "): read failed, error code " << err);
+                        streamer->setError();
+                        return;
+                    }
+                    streamer->readQ.push(std::move(buf));
+                    streamer->notifyRead();
+                }
+                streamer->waitTransit();
+            }
+        }
+
+      private:
+        AudioStreamer* m_streamer;
+    };
+
+    Receiver receiver;
+
+    // Pool buffers cycle poolQ -> writeQ -> transitQ -> readQ -> poolQ, so the steady state
+    // performs no allocations on the DAW's audio thread.
+    AudioMidiBuffer getPoolBuffer(int channels, int samples) {
+        AudioMidiBuffer buf;
+        if (!poolQ.pop(buf)) {
+            // pool exhausted, pay the allocation
+            logln_clnt(client, "warning: instance (" << client->getLoadedPluginsString() << "): buffer pool empty");
+        }
+        buf.audio.setSize(channels, samples);  // no-op for a pre-sized pool buffer
+        buf.midi.clear();
+        return buf;
+    }
+
+    void returnPoolBuffer(AudioMidiBuffer& buf) {
+        buf.midi.clear();
+        poolQ.push(std::move(buf));
+    }
+
     void send(AudioBuffer<T>& buffer, MidiBuffer& midi, AudioPlayHead::CurrentPositionInfo& posInfo) {
         if (error) {
             return;
         }
-        if (client->NUM_OF_BUFFERS > 1) {
-            if (buffer.getNumSamples() == client->m_samplesPerBlock && workingSendSamples == 0) {
-                AudioMidiBuffer buf;
-                buf.audio.makeCopyOf(buffer);
+        if (numBuffers > 1) {
+            if (buffer.getNumSamples() == client->m_samplesPerBlock && workingSendBuf.samples == 0) {
+                AudioMidiBuffer buf = getPoolBuffer(buffer.getNumChannels(), buffer.getNumSamples());
+                for (int chan = 0; chan < buffer.getNumChannels(); chan++) {
+                    buf.audio.copyFrom(chan, 0, buffer, chan, 0, buffer.getNumSamples());
+                }
                 buf.midi.addEvents(midi, 0, midi.getNumEvents(), 0);
                 buf.posInfo = posInfo;
+                buf.enqueuedAt = Time::getMillisecondCounterHiRes();
                 writeQ.push(std::move(buf));
                 notifyWrite();
             } else {
-                copyToWorkingBuffer(workingSendBuf, workingSendSamples, buffer, midi);
-                if (workingSendSamples >= client->m_samplesPerBlock) {
-                    AudioMidiBuffer buf;
-                    buf.audio.setSize(client->m_channels, client->m_samplesPerBlock);
-                    for (int chan = 0; chan < client->m_channels; chan++) {
-                        buf.audio.copyFrom(chan, 0, workingSendBuf.audio, chan, 0, client->m_samplesPerBlock);
-                    }
+                workingSendBuf.push(buffer, midi);
+                if (workingSendBuf.samples >= client->m_samplesPerBlock) {
+                    AudioMidiBuffer buf = getPoolBuffer(client->m_channels, client->m_samplesPerBlock);
+                    workingSendBuf.pop(buf.audio, client->m_samplesPerBlock);
                     buf.midi.addEvents(workingSendBuf.midi, 0, workingSendBuf.midi.getNumEvents(), 0);
                     buf.posInfo = posInfo;
+                    buf.enqueuedAt = Time::getMillisecondCounterHiRes();
                     writeQ.push(std::move(buf));
                     notifyWrite();
-                    workingSendSamples -= client->m_samplesPerBlock;
-                    if (workingSendSamples > 0) {
-                        shiftSamplesToFront(workingSendBuf.audio, client->m_samplesPerBlock, workingSendSamples);
-                    }
                     workingSendBuf.midi.clear();
                 }
             }
         } else {
-            AudioMidiBuffer buf;
-            buf.audio.makeCopyOf(buffer);
+            AudioMidiBuffer buf = getPoolBuffer(buffer.getNumChannels(), buffer.getNumSamples());
+            for (int chan = 0; chan < buffer.getNumChannels(); chan++) {
+                buf.audio.copyFrom(chan, 0, buffer, chan, 0, buffer.getNumSamples());
+            }
             buf.midi.addEvents(midi, 0, midi.getNumEvents(), 0);
             buf.posInfo = posInfo;
             if (!sendReal(buf)) {
                 logln_clnt(client, "error: instance (" << client->getLoadedPluginsString() << "): send failed");
                 setError();
             }
+            returnPoolBuffer(buf);
         }
     }
 
@@ -176,35 +395,63 @@ class AudioStreamer : public Thread {
             return;
         }
         AudioMidiBuffer buf;
-        if (client->NUM_OF_BUFFERS > 1) {
-            if (buffer.getNumSamples() == client->m_samplesPerBlock && workingReadSamples == 0) {
-                if (waitRead()) {
+        if (numBuffers > 1) {
+            if (!client->m_nonRealtime && adapt()) {
+                // the window deepens by one block: this one stays queued, play silence once
+                buffer.clear();
+                midi.clear();
+                return;
+            }
+            if (client->m_liveMode) {
+                dropStale();
+            }
+            // In live mode the wait is bounded by the block period. On a miss the DAW keeps its
+            // dry signal and the late block gets dropped later to restore the stream latency.
+            double deadline = 0.0;
+            if (client->m_liveMode) {
+                deadline = Time::getMillisecondCounterHiRes() +
+                           jmax(1.0, client->m_samplesPerBlock * 1000.0 / client->m_rate);
+            }
+            if (buffer.getNumSamples() == client->m_samplesPerBlock && workingReadBuf.samples == 0) {
+                while (readsBehind > 0 && readQ.read_available() > 1) {
                     readQ.pop(buf);
-                    buffer.makeCopyOf(buf.audio);
-                    midi.clear();
-                    midi.addEvents(buf.midi, 0, buf.midi.getNumEvents(), 0);
+                    returnPoolBuffer(buf);
+                    readsBehind--;
+                }
+                if (!waitRead(deadline)) {
+                    if (client->m_liveMode) {
+                        xrun();
+                    }
+                    return;
                 }
+                readQ.pop(buf);
+                buffer.makeCopyOf(buf.audio);
+                midi.clear();
+                midi.addEvents(buf.midi, 0, buf.midi.getNumEvents(), 0);
+                returnPoolBuffer(buf);
             } else {
-                if (workingReadSamples < buffer.getNumSamples()) {
-                    if (!waitRead()) {
+                while (readsBehind > 0 && workingReadBuf.samples >= 2 * buffer.getNumSamples()) {
+                    workingReadBuf.skip(buffer.getNumSamples());
+                    readsBehind--;
+                }
+                while (workingReadBuf.samples < buffer.getNumSamples()) {
+                    if (!waitRead(deadline)) {
+                        if (client->m_liveMode) {
+                            xrun();
+                        }
                         return;
                     }
                     readQ.pop(buf);
-                    copyToWorkingBuffer(workingReadBuf, workingReadSamples, buf.audio, buf.midi);
-                }
-                for (int chan = 0; chan < buffer.getNumChannels(); chan++) {
-                    buffer.copyFrom(chan, 0, workingReadBuf.audio, chan, 0, buffer.getNumSamples());
-                }
-                workingReadSamples -= buffer.getNumSamples();
-                if (workingReadSamples > 0) {
-                    shiftSamplesToFront(workingReadBuf.audio, buffer.getNumSamples(), workingReadSamples);
+                    workingReadBuf.push(buf.audio, buf.midi);
+                    returnPoolBuffer(buf);
                 }
+                workingReadBuf.pop(buffer, buffer.getNumSamples());
                 midi.clear();
-                midi.addEvents(buf.midi, 0, workingReadBuf.midi.getNumEvents(), 0);
+                midi.addEvents(workingReadBuf.midi, 0, workingReadBuf.midi.getNumEvents(), 0);
                 workingReadBuf.midi.clear();
             }
         } else {
-            buf.audio.setSize(buffer.getNumChannels(), buffer.getNumSamples());
+            buf = getPoolBuffer(buffer.getNumChannels(), buffer.getNumSamples());
             MessageHelper::Error err;
             if (!readReal(buf, &err)) {
                 logln_clnt(client, "error: instance (" << client->getLoadedPluginsString()
@@ -215,47 +462,164 @@ class AudioStreamer : public Thread {
             buffer.makeCopyOf(buf.audio);
             midi.clear();
             midi.addEvents(buf.midi, 0, buf.midi.getNumEvents(), 0);
+            returnPoolBuffer(buf);
         }
     }
 
-    void copyToWorkingBuffer(AudioMidiBuffer& dst, int& workingSamples, AudioBuffer<T>& src, MidiBuffer& midi) {
-        if ((dst.audio.getNumSamples() - workingSamples) < src.getNumSamples()) {
-            dst.audio.setSize(src.getNumChannels(), workingSamples + src.getNumSamples(), true);
+    // Feedback controller for the pipelining window, called once per block on the DAW thread.
+    // Underruns within the observation window grow the effective depth by one block, a full
+    // window with at least two blocks of surplus shrinks it back, so the latency reported via
+    // getLatencySamples tracks the jitter the connection actually shows. Returns true when the
+    // current block stays queued to deepen the window, the caller plays silence in that case.
+    bool adapt() {
+        int fill = static_cast<int>(readQ.read_available());
+        if (fill == 0) {
+            adaptUnderruns++;
+        } else if (fill < adaptMinFill) {
+            adaptMinFill = fill;
+        }
+        bool grow = false;
+        if (++adaptBlocks >= ADAPT_WINDOW_BLOCKS) {
+            if (adaptUnderruns > 0 && effBuffers < numBuffers * 2 - 2) {
+                effBuffers++;
+                client->m_effBuffers = effBuffers;
+                grow = true;
+                logln_clnt(client, "instance (" << client->getLoadedPluginsString() << "): jitter up ("
+                                                << adaptUnderruns << " underruns), growing buffering to " << effBuffers
+                                                << " blocks");
+            } else if (adaptUnderruns == 0 && adaptMinFill > 1 && effBuffers > 2) {
+                effBuffers--;
+                client->m_effBuffers = effBuffers;
+                readsBehind++;  // drop one queued block to realize the shallower window
+                logln_clnt(client, "instance (" << client->getLoadedPluginsString()
+                                                << "): stable stream, shrinking buffering to " << effBuffers
+                                                << " blocks");
+            }
+            adaptBlocks = 0;
+            adaptUnderruns = 0;
+            adaptMinFill = numBuffers * 2;
         }
-        for (int chan = 0; chan < src.getNumChannels(); chan++) {
-            dst.audio.copyFrom(chan, workingSamples, src, chan, 0, src.getNumSamples());
+        if (grow) {
+            // the kept block stays in the queue, hand the send side a fresh buffer so the pool
+            // keeps one credit per block in flight
+            AudioMidiBuffer extra;
+            extra.audio.setSize(client->m_channels, client->m_samplesPerBlock);
+            extra.audio.clear();
+            poolQ.push(std::move(extra));
         }
-        workingSamples += src.getNumSamples();
-        dst.midi.addEvents(midi, 0, midi.getNumEvents(), 0);
+        return grow;
     }
 
-    void shiftSamplesToFront(AudioBuffer<T>& buf, int start, int num) {
-        if (start + num <= buf.getNumSamples()) {
-            for (int chan = 0; chan < buf.getNumChannels(); chan++) {
-                for (int s = 0; s < num; s++) {
-                    buf.setSample(chan, s, buf.getSample(chan, start + s));
-                }
+    // Live mode bounds the age of what the listener hears, not the loss: blocks that sat in the
+    // queue past the allowed age are late either way, so they get dropped and counted. The age
+    // limit is configurable, by default it sits one block above the pipelining depth.
+    void dropStale() {
+        double maxAgeMs = client->m_liveMaxBlockAgeMs > 0
+                              ? static_cast<double>(client->m_liveMaxBlockAgeMs)
+                              : (effBuffers + 1) * client->m_samplesPerBlock * 1000.0 / client->m_rate;
+        auto now = Time::getMillisecondCounterHiRes();
+        while (readQ.read_available() > 0 && readQ.front().enqueuedAt > 0.0 &&
+               now - readQ.front().enqueuedAt > maxAgeMs) {
+            AudioMidiBuffer buf;
+            readQ.pop(buf);
+            returnPoolBuffer(buf);
+            auto count = ++client->m_drops;
+            if (readsBehind > 0) {
+                readsBehind--;  // a dropped block also repays a missed deadline
+            }
+            if (count == 1 || count % 100 == 0) {
+                logln_clnt(client, "warning: instance (" << client->getLoadedPluginsString()
+                                                         << "): dropped stale block (drops=" << count << ")");
             }
         }
     }
 
+    void xrun() {
+        auto count = ++client->m_xruns;
+        readsBehind++;
+        if (count == 1 || count % 100 == 0) {
+            logln_clnt(client, "warning: instance (" << client->getLoadedPluginsString()
+                                                     << "): read deadline missed, playing dry signal (xruns=" << count
+                                                     << ")");
+        }
+    }
+
+    // smoothing for the latency breakdown, relaxed stores are fine for a UI readout
+    static void ewma(std::atomic<double>& v, double sample) {
+        double cur = v.load(std::memory_order_relaxed);
+        v.store(cur > 0.0 ? cur * 0.95 + sample * 0.05 : sample, std::memory_order_relaxed);
+    }
+
     bool sendReal(AudioMidiBuffer& buffer) {
-        AudioMessage msg;
+        if (buffer.enqueuedAt > 0.0) {
+            ewma(client->m_latencyBreakdown.queueMs, Time::getMillisecondCounterHiRes() - buffer.enqueuedAt);
+        }
+        // when the server chain runs in single precision, doubles on the wire would get converted
+        // down on arrival anyways, so convert here and send half the bytes
+        buffer.wireIsFloat = std::is_same<T, double>::value && client->m_serverChainFloatOnly;
+        if (buffer.wireIsFloat) {
+            AudioConvert::convert(wireSendBuf, buffer.audio);
+            return sendWire(wireSendBuf, buffer);
+        }
+        return sendWire(buffer.audio, buffer);
+    }
+
+    template <typename W>
+    bool sendWire(AudioBuffer<W>& audio, AudioMidiBuffer& buffer) {
+        if (client->m_shmUp.isOpen()) {
+            return sendMsg.sendToServer(client->m_shmUp, audio, buffer.midi, buffer.posInfo);
+        }
+        if (nullptr != client->m_audio_udp) {
+            return sendMsg.sendToServer(*client->m_audio_udp, audio, buffer.midi, buffer.posInfo);
+        }
         if (nullptr != socket) {
-            return msg.sendToServer(socket, buffer.audio, buffer.midi, buffer.posInfo);
+            return sendMsg.sendToServer(socket, audio, buffer.midi, buffer.posInfo);
         } else {
             return false;
         }
     }
 
     bool readReal(AudioMidiBuffer& buffer, MessageHelper::Error* e) {
-        AudioMessage msg;
-        bool success = false;
-        if (nullptr != socket) {
-            success = msg.readFromServer(socket, buffer.audio, buffer.midi, e);
+        bool success;
+        if (buffer.wireIsFloat) {
+            wireReadBuf.setSize(buffer.audio.getNumChannels(), buffer.audio.getNumSamples(), false, false, true);
+            success = readWire(wireReadBuf, buffer, e);
+            if (success) {
+                AudioConvert::convert(buffer.audio, wireReadBuf);
+            }
+        } else {
+            success = readWire(buffer.audio, buffer, e);
         }
         if (success) {
-            client->m_latency = msg.getLatencySamples();
+            client->m_latency = readMsg.getLatencySamples();
+            double t1 = readMsg.getRespClientSentAt();  // older servers leave the stamps zeroed
+            if (t1 > 0.0) {
+                double t2 = readMsg.getRespReceivedAt();
+                double t3 = readMsg.getRespProcEndAt();
+                double t4 = Time::getMillisecondCounterHiRes();
+                // NTP style offset estimate: both wire legs are assumed symmetric, t2/t3 run on
+                // the server clock, t1/t4 on ours
+                double offset = ((t2 - t1) + (t3 - t4)) / 2;
+                auto& bd = client->m_latencyBreakdown;
+                ewma(bd.wireUpMs, t2 - t1 - offset);
+                ewma(bd.srvQueueMs, readMsg.getRespProcStartAt() - t2);
+                ewma(bd.dspMs, t3 - readMsg.getRespProcStartAt());
+                ewma(bd.wireDownMs, t4 - t3 + offset);
+                ewma(bd.totalMs, t4 - t1);
+            }
+        }
+        return success;
+    }
+
+    template <typename W>
+    bool readWire(AudioBuffer<W>& audio, AudioMidiBuffer& buffer, MessageHelper::Error* e) {
+        bool success = false;
+        if (client->m_shmDown.isOpen()) {
+            success = readMsg.readFromServer(client->m_shmDown, audio, buffer.midi, e);
+        } else if (nullptr != client->m_audio_udp) {
+            success = readMsg.readFromServer(*client->m_audio_udp, audio, buffer.midi, e);
+        } else if (nullptr != socket) {
+            success = readMsg.readFromServer(socket, audio, buffer.midi, e);
         }
         return success;
     }
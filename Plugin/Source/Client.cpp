@@ -7,10 +7,14 @@
 
 #include "Client.hpp"
 #include "PluginProcessor.hpp"
-#include "ImageDiff.hpp"
+
+#include <algorithm>
 
 namespace e47 {
 
+HashMap<String, Client::PluginListCacheEntry> Client::m_pluginListCache;
+std::mutex Client::m_pluginListCacheMtx;
+
 Client::Client(AudioGridderAudioProcessor* processor)
     : Thread("Client"),
       m_processor(processor),
@@ -18,6 +22,9 @@ Client::Client(AudioGridderAudioProcessor* processor)
       m_cmd_socket(nullptr),
       m_audio_socket(nullptr),
       m_screen_socket(nullptr) {
+    while (m_sessionToken == 0) {
+        m_sessionToken = static_cast<uint32>(Random::getSystemRandom().nextInt());
+    }
     startThread();
 }
 
@@ -41,6 +48,31 @@ void Client::run() {
                         reconnect();
                     }
                 }
+                int newFlags = 0;
+                if (j.find("AudioWireInt16") != j.end() && j["AudioWireInt16"].get<bool>()) {
+                    newFlags |= AUDIO_WIRE_INT16;
+                }
+                if (j.find("AudioWireUDP") != j.end() && j["AudioWireUDP"].get<bool>()) {
+                    newFlags |= AUDIO_WIRE_UDP;
+                }
+                if (j.find("WireMux") != j.end() && j["WireMux"].get<bool>()) {
+                    newFlags |= WIRE_MUX;
+                }
+                if (m_audioFlags != newFlags) {
+                    m_audioFlags = newFlags;
+                    reconnect();
+                }
+                if (j.find("LiveMode") != j.end()) {
+                    // takes effect on the next block, no reconnect needed
+                    m_liveMode = j["LiveMode"].get<bool>();
+                }
+                if (j.find("LiveMaxBlockAgeMs") != j.end()) {
+                    m_liveMaxBlockAgeMs = j["LiveMaxBlockAgeMs"].get<int>();
+                }
+                if (j.find("CaptureStream") != j.end()) {
+                    // takes effect on the next connect, captures the outgoing request stream
+                    m_captureStreamPath = j["CaptureStream"].get<std::string>();
+                }
             }
         } catch (json::parse_error& e) {
             logln("parsing config failed: " << e.what());
@@ -84,6 +116,78 @@ void Client::setServer(const String& host, int port) {
     }
 }
 
+Client::ServerLoadInfo Client::probeServer(const String& server, int port) {
+    ServerLoadInfo info;
+    auto hostParts = StringArray::fromTokens(server, ":", "");
+    String host = hostParts[0];
+    int id = hostParts.size() > 1 ? hostParts[1].getIntValue() : 0;
+    StreamingSocket sock;
+    auto start = Time::getMillisecondCounterHiRes();
+    if (!sock.connect(host, port + id, 1000)) {
+        return info;
+    }
+    Handshake cfg = {HANDSHAKE_PROBE, 0, 0, 0, 0, false, 0, 0, 0};
+    if (!e47::send(&sock, reinterpret_cast<const char*>(&cfg), sizeof(cfg))) {
+        return info;
+    }
+    Message<ServerLoad> msg;
+    if (!msg.read(&sock, nullptr, 2000)) {
+        return info;
+    }
+    info.rttMs = Time::getMillisecondCounterHiRes() - start;
+    auto j = PLD(msg).getJson();
+    info.workers = j["workers"].get<int>();
+    info.procTimeMs = j["procTimeMs"].get<double>();
+    info.available = true;
+    return info;
+}
+
+std::vector<Client::DiscoveredServer> Client::discoverServers(int timeoutMs) {
+    std::vector<DiscoveredServer> servers;
+    DatagramSocket sock(true);  // enable broadcasting
+    if (!sock.bindToPort(0)) {
+        return servers;
+    }
+    uint32 magic = DISCOVERY_QUERY;
+    auto start = Time::getMillisecondCounterHiRes();
+    if (sock.write("255.255.255.255", DEFAULT_DISCOVERY_PORT, &magic, sizeof(magic)) != sizeof(magic)) {
+        return servers;
+    }
+    // collect answers until the window closes, one datagram per server
+    char buf[1024];
+    while (true) {
+        auto remaining = timeoutMs - (Time::getMillisecondCounterHiRes() - start);
+        if (remaining <= 0 || sock.waitUntilReady(true, static_cast<int>(remaining)) < 1) {
+            break;
+        }
+        String senderHost;
+        int senderPort = 0;
+        int len = sock.read(buf, sizeof(buf) - 1, false, senderHost, senderPort);
+        if (len < 1) {
+            continue;
+        }
+        try {
+            json j = json::parse(buf, buf + len);
+            DiscoveredServer srv;
+            srv.server = senderHost;
+            int id = j["id"].get<int>();
+            if (id > 0) {
+                srv.server << ":" << id;
+            }
+            srv.name = j["name"].get<std::string>();
+            srv.rttMs = Time::getMillisecondCounterHiRes() - start;
+            srv.workers = j["workers"].get<int>();
+            srv.procTimeMs = j["procTimeMs"].get<double>();
+            servers.push_back(std::move(srv));
+        } catch (json::exception&) {
+            // not one of ours
+        }
+    }
+    std::sort(servers.begin(), servers.end(),
+              [](const DiscoveredServer& a, const DiscoveredServer& b) { return a.score() < b.score(); });
+    return servers;
+}
+
 String Client::getServerHost() {
     std::lock_guard<std::mutex> lock(m_srvMtx);
     return m_srvHost;
@@ -138,6 +242,9 @@ void Client::init() {
     }
     dbglock(*this, 9);
     m_error = true;
+    clearParameterCache();
+    m_serverChainFloatOnly = false;
+    m_sessionResumed = false;
     if (!m_channels || !m_rate || !m_samplesPerBlock) {
         return;
     }
@@ -160,11 +267,52 @@ void Client::init() {
         }
 
         logln("client listener created, PORT=" << clientPort);
+        m_clientPort = clientPort;
 
         // set master socket non-blocking
         fcntl(sock.getRawSocketHandle(), F_SETFL, fcntl(sock.getRawSocketHandle(), F_GETFL, 0) | O_NONBLOCK);
 
-        Handshake cfg = {1, clientPort, m_channels, m_rate, m_samplesPerBlock, m_doublePrecission};
+        int flags = m_audioFlags;
+        bool local = !host.compare("127.0.0.1") || !host.compare("localhost");
+        if (local) {
+            // skip the loopback TCP stack and exchange audio blocks through shared memory
+            uint32_t slotSize =
+                static_cast<uint32_t>(sizeof(AudioMessage::RequestHeader) + sizeof(AudioPlayHead::CurrentPositionInfo) +
+                                      m_channels * m_samplesPerBlock * sizeof(double) + 8192);
+            String base = "/ag." + String(clientPort);
+            if (m_shmUp.create(base + ".up", slotSize, static_cast<uint32_t>(NUM_OF_BUFFERS * 2)) &&
+                m_shmDown.create(base + ".dn", slotSize, static_cast<uint32_t>(NUM_OF_BUFFERS * 2))) {
+                flags |= AUDIO_WIRE_SHM;
+                logln("using shared memory audio transport");
+            } else {
+                m_shmUp.close();
+                m_shmDown.close();
+            }
+        }
+        if (flags & AUDIO_WIRE_SHM) {
+            // same-host shared memory beats the loopback in every case
+            flags &= ~AUDIO_WIRE_UDP;
+        } else if (flags & AUDIO_WIRE_UDP) {
+            size_t maxPacket = sizeof(uint32) + sizeof(AudioMessage::RequestHeader) +
+                               m_channels * m_samplesPerBlock * sizeof(double) +
+                               sizeof(AudioPlayHead::CurrentPositionInfo) + 4096;
+            m_audio_udp = std::make_unique<DatagramSocket>();
+            if (maxPacket > UDP_MAX_PACKET || !m_audio_udp->bindToPort(clientPort)) {
+                logln("unable to set up UDP audio transport, staying on TCP");
+                m_audio_udp.reset();
+                flags &= ~AUDIO_WIRE_UDP;
+            }
+        }
+
+        String listCacheKey = host + ":" + String(id);
+        uint32 cachedListHash;
+        {
+            std::lock_guard<std::mutex> lock(m_pluginListCacheMtx);
+            cachedListHash = m_pluginListCache.getReference(listCacheKey).hash;
+        }
+
+        Handshake cfg = {7,     clientPort,     m_channels,    m_rate, m_samplesPerBlock, m_doublePrecission,
+                         flags, cachedListHash, m_sessionToken};
         if (!e47::send(m_cmd_socket.get(), reinterpret_cast<const char*>(&cfg), sizeof(cfg))) {
             m_cmd_socket->close();
             return;
@@ -173,6 +321,18 @@ void Client::init() {
         m_audio_socket = std::unique_ptr<StreamingSocket>(accept(sock));
         if (nullptr != m_audio_socket) {
             logln("audio connection established");
+            if (nullptr != m_audio_udp) {
+                // the server announces its datagram port with a hello packet
+                uint32 magic = 0;
+                if (m_audio_udp->waitUntilReady(true, 5000) > 0 &&
+                    m_audio_udp->read(&magic, sizeof(magic), false, m_udpPeerHost, m_udpPeerPort) == sizeof(magic) &&
+                    magic == UDP_HELLO) {
+                    logln("using UDP audio transport, server port " << m_udpPeerPort);
+                } else {
+                    logln("no UDP hello from server, staying on TCP");
+                    m_audio_udp.reset();
+                }
+            }
             if (m_doublePrecission) {
                 m_audioStreamerD.reset(new AudioStreamer<double>(this, m_audio_socket.get()));
                 m_audioStreamerD->startThread(Thread::realtimeAudioPriority);
@@ -184,29 +344,65 @@ void Client::init() {
             return;
         }
 
-        m_screen_socket = std::unique_ptr<StreamingSocket>(accept(sock));
-        if (nullptr != m_screen_socket) {
-            logln("screen connection established");
-            m_screenWorker = std::make_unique<ScreenReceiver>(this, m_screen_socket.get());
-            m_screenWorker->startThread();
-        } else {
-            return;
+        if ((flags & WIRE_MUX) == 0) {
+            m_screen_socket = std::unique_ptr<StreamingSocket>(accept(sock));
+            if (nullptr != m_screen_socket) {
+                logln("screen connection established");
+                m_screenWorker = std::make_unique<ScreenReceiver>(this, m_screen_socket.get());
+                m_screenWorker->startThread();
+            } else {
+                return;
+            }
         }
 
-        // receive plugin list
+        // receive plugin list, or the server's refusal when it is at its configured capacity
         m_plugins.clear();
-        Message<PluginList> msg;
-        if (!msg.read(m_cmd_socket.get())) {
+        auto msgAny = std::make_shared<Message<Any>>();
+        if (!msgAny->read(m_cmd_socket.get())) {
             logln("failed reading plugin list");
             return;
         }
-        String listChunk(PLD(msg).str, *PLD(msg).size);
-        auto list = StringArray::fromLines(listChunk);
-        for (auto& line : list) {
-            if (!line.isEmpty()) {
-                auto parts = StringArray::fromTokens(line, "|", "");
-                m_plugins.push_back(ServerPlugin::fromString(line));
+        if (msgAny->getType() == Result::Type) {
+            auto res = Message<Any>::convert<Result>(msgAny);
+            logln("server refused the connection: " << pPLD(res).getString());
+            return;
+        }
+        auto msgList = Message<Any>::convert<PluginList>(msgAny);
+        auto& msg = *msgList;
+        if (*PLD(msg).size > 0) {
+            MemoryInputStream mis(PLD(msg).data, (size_t)*PLD(msg).size, false);
+            GZIPDecompressorInputStream gz(&mis, false);
+            String listChunk = gz.readEntireStreamAsString();
+            auto list = StringArray::fromLines(listChunk);
+            for (auto& line : list) {
+                if (!line.isEmpty()) {
+                    m_plugins.push_back(ServerPlugin::fromString(line));
+                }
             }
+            std::lock_guard<std::mutex> lock(m_pluginListCacheMtx);
+            auto& entry = m_pluginListCache.getReference(listCacheKey);
+            entry.hash = (uint32)listChunk.hashCode();
+            entry.plugins = m_plugins;
+        } else {
+            // the server confirmed that the cached list is still current
+            std::lock_guard<std::mutex> lock(m_pluginListCacheMtx);
+            m_plugins = m_pluginListCache.getReference(listCacheKey).plugins;
+        }
+        // resume acknowledgement: a non-negative return code means the server still holds the
+        // chain of the previous connection, no need to restore it plugin by plugin
+        auto result = MessageFactory::getResult(m_cmd_socket.get());
+        if (nullptr != result && result->getReturnCode() > -1) {
+            m_latency = result->getReturnCode();
+            m_sessionResumed = true;
+            logln("server resumed the session, latency " << m_latency);
+        }
+        if (flags & WIRE_MUX) {
+            // the handshake exchange above is done, from here on the pump owns all reads on the
+            // command socket and the synchronous calls go through readCmdMessage
+            m_screenWorker = std::make_unique<ScreenReceiver>(this, m_cmd_socket.get(), true);
+            m_muxed = true;
+            m_screenWorker->startThread();
+            logln("screen stream multiplexed onto the command connection");
         }
         m_ready = true;
         m_error = false;
@@ -227,8 +423,9 @@ bool Client::isReady() {
         }
     }
     if (locked) {
-        m_ready = !m_error && nullptr != m_cmd_socket && m_cmd_socket->isConnected() &&
-                  m_screenWorker->isThreadRunning() && nullptr != m_screen_socket && m_screen_socket->isConnected() &&
+        bool screenOk = nullptr != m_screenWorker && m_screenWorker->isThreadRunning() &&
+                        (m_muxed || (nullptr != m_screen_socket && m_screen_socket->isConnected()));
+        m_ready = !m_error && nullptr != m_cmd_socket && m_cmd_socket->isConnected() && screenOk &&
                   nullptr != m_audio_socket && m_audio_socket->isConnected();
         m_clientMtx.unlock();
     } else {
@@ -250,8 +447,10 @@ void Client::close() {
         m_screen_socket->close();
     }
     if (nullptr != m_screenWorker && m_screenWorker->isThreadRunning()) {
+        // in mux mode this is the pump on the command socket, it has to be gone before the
+        // socket goes away below
         m_screenWorker->signalThreadShouldExit();
-        m_screenWorker->waitForThreadToExit(100);
+        m_screenWorker->waitForThreadToExit(1000);
         m_screenWorker.reset();
         m_screen_socket.reset();
     }
@@ -262,6 +461,11 @@ void Client::close() {
         m_cmd_socket->close();
         m_cmd_socket.reset();
     }
+    m_muxed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_cmdRepliesMtx);
+        m_cmdReplies.clear();
+    }
     if (nullptr != m_audio_socket) {
         m_audio_socket->close();
     }
@@ -276,18 +480,18 @@ void Client::close() {
         m_audioStreamerF.reset();
     }
     m_audio_socket.reset();
+    m_audio_udp.reset();
+    m_shmUp.close();
+    m_shmDown.close();
 }
 
-Image Client::getPluginScreen() {
-    std::lock_guard<std::mutex> lock(m_pluginScreenMtx);
-    return *m_pluginScreen;
-}
+std::shared_ptr<Image> Client::getPluginScreen() { return std::atomic_load(&m_pluginScreen); }
 
 void Client::setPluginScreen(std::shared_ptr<Image> img, int w, int h) {
+    std::atomic_store(&m_pluginScreen, img);
     std::lock_guard<std::mutex> lock(m_pluginScreenMtx);
-    m_pluginScreen = img;
     if (m_pluginScreenUpdateCallback) {
-        m_pluginScreenUpdateCallback(m_pluginScreen, w, h);
+        m_pluginScreenUpdateCallback(img, w, h);
     }
 }
 
@@ -297,60 +501,160 @@ void Client::quit() {
     msg.send(m_cmd_socket.get());
 }
 
+std::shared_ptr<Result> Client::getCmdResult() {
+    if (!m_muxed) {
+        return MessageFactory::getResult(m_cmd_socket.get());
+    }
+    auto msg = std::make_shared<Message<Result>>();
+    if (readCmdMessage(*msg, nullptr, 5000)) {
+        // aliased pointer, the payload stays alive through the message
+        return std::shared_ptr<Result>(msg, &msg->payload);
+    }
+    return nullptr;
+}
+
 bool Client::addPlugin(String id, StringArray& presets, Array<Parameter>& params, String settings) {
+    Array<AddPluginRequest> requests;
+    requests.add({id, settings, false, false, {}, std::move(params)});
+    if (!addPlugins(requests)) {
+        return false;
+    }
+    auto& req = requests.getReference(0);
+    presets = req.presets;
+    params = std::move(req.params);
+    return req.ok;
+}
+
+bool Client::addPlugins(Array<AddPluginRequest>& requests) {
     if (!isReadyLockFree()) {
         return false;
     };
-    Message<AddPlugin> msg;
-    PLD(msg).setString(id);
     dbglock(*this, 11);
-    if (msg.send(m_cmd_socket.get())) {
-        auto result = MessageFactory::getResult(m_cmd_socket.get(), 10);
-        if (nullptr == result) {
-            logln("  failed to get result");
-            return false;
+    // The whole chain goes out as one ChainSnapshot message and comes back in one reply, so a
+    // restore costs a single round trip no matter how many plugins are loaded.
+    MemoryOutputStream mos;
+    mos.writeInt(requests.size());
+    for (auto& req : requests) {
+        mos.writeString(req.id);
+        mos.writeBool(req.bypass);
+        MemoryBlock settings;
+        if (req.settings.isNotEmpty()) {
+            settings.fromBase64Encoding(req.settings);
         }
-        if (result->getReturnCode() < 0) {
-            logln("  negative return code");
+        mos.writeInt(static_cast<int>(settings.getSize()));
+        mos.write(settings.getData(), settings.getSize());
+    }
+    Message<ChainSnapshot> msg;
+    PLD(msg).setData(static_cast<const char*>(mos.getData()), static_cast<int>(mos.getDataSize()));
+    if (!msg.send(m_cmd_socket.get())) {
+        logln("  failed to send chain snapshot");
+        return false;
+    }
+    // loading a chain of heavy plugins can take a while, keep waiting on timeouts
+    Message<ChainSnapshot> ret;
+    MessageHelper::Error err;
+    int attempts = 120;
+    while (!readCmdMessage(ret, &err)) {
+        if (err != MessageHelper::E_TIMEOUT || --attempts < 1) {
+            logln("  failed to read chain snapshot result");
             return false;
         }
-        m_latency = result->getReturnCode();
-        Message<Presets> msgPresets;
-        if (!msgPresets.read(m_cmd_socket.get())) {
-            logln("  failed to read presets");
-            return false;
+    }
+    MemoryInputStream mis(PLD(ret).data, static_cast<size_t>(*PLD(ret).size), false);
+    int num = mis.readInt();
+    for (int i = 0; i < num && i < requests.size(); i++) {
+        auto& req = requests.getReference(i);
+        req.ok = mis.readBool();
+        if (!req.ok) {
+            logln("  failed to add " << req.id);
         }
-        presets = StringArray::fromTokens(msgPresets.payload.getString(), "|", "");
-        Message<Parameters> msgParams;
-        if (!msgParams.read(m_cmd_socket.get())) {
-            logln("  failed to read parameters");
-            return false;
+    }
+    m_latency = mis.readInt();
+    if (!mis.isExhausted()) {
+        m_serverChainFloatOnly = !mis.readBool();
+    }
+    return true;
+}
+
+StringArray Client::getPresets(int idx) {
+    StringArray presets;
+    if (!isReadyLockFree()) {
+        return presets;
+    };
+    Message<GetPresets> msg;
+    PLD(msg).setNumber(idx);
+    dbglock(*this, 27);
+    if (msg.send(m_cmd_socket.get())) {
+        Message<Presets> res;
+        if (readCmdMessage(res)) {
+            presets = StringArray::fromTokens(res.payload.getString(), "|", "");
+        } else {
+            logln(getLoadedPluginsString() << "failed to read Presets message");
+            m_error = true;
         }
-        auto jparams = msgParams.payload.getJson();
-        Array<Parameter> paramsBak(std::move(params));
-        for (auto& jparam : jparams) {
-            auto newParam = Parameter::fromJson(jparam);
-            for (auto& oldParam : paramsBak) {
-                if (newParam.idx == oldParam.idx) {
-                    newParam.automationSlot = oldParam.automationSlot;
-                    break;
-                }
+    }
+    return presets;
+}
+
+Array<Client::Parameter> Client::getParameters(int idx) {
+    Array<Parameter> params;
+    if (!isReadyLockFree()) {
+        return params;
+    };
+    Message<GetParameters> msg;
+    PLD(msg).setNumber(idx);
+    dbglock(*this, 28);
+    if (msg.send(m_cmd_socket.get())) {
+        Message<ParametersPacked> res;
+        if (readCmdMessage(res)) {
+            MemoryInputStream mis(PLD(res).data, static_cast<size_t>(*PLD(res).size), false);
+            int numParams = mis.readInt();
+            params.ensureStorageAllocated(numParams);
+            for (int i = 0; i < numParams; i++) {
+                params.add(Parameter::fromStream(mis));
             }
-            params.add(std::move(newParam));
+        } else {
+            logln(getLoadedPluginsString() << "failed to read ParametersPacked message");
+            m_error = true;
         }
-        Message<PluginSettings> msgSettings;
-        if (settings.isNotEmpty()) {
-            MemoryBlock block;
-            block.fromBase64Encoding(settings);
-            msgSettings.payload.setData(block.begin(), static_cast<int>(block.getSize()));
+    }
+    return params;
+}
+
+std::vector<MemoryBlock> Client::getChainSettings() {
+    std::vector<MemoryBlock> ret;
+    if (!isReadyLockFree()) {
+        return ret;
+    };
+    dbglock(*this, 25);
+    // an empty ChainSnapshot queries the settings of every loaded plugin in one round trip
+    Message<ChainSnapshot> msg;
+    PLD(msg).setData(nullptr, 0);
+    if (!msg.send(m_cmd_socket.get())) {
+        m_error = true;
+        return ret;
+    }
+    Message<ChainSnapshot> res;
+    MessageHelper::Error err;
+    int attempts = 30;
+    while (!readCmdMessage(res, &err)) {
+        if (err != MessageHelper::E_TIMEOUT || --attempts < 1) {
+            logln("failed to read chain settings");
+            m_error = true;
+            return ret;
         }
-        if (!msgSettings.send(m_cmd_socket.get())) {
-            logln("  failed to send settings");
-            return false;
+    }
+    MemoryInputStream mis(PLD(res).data, static_cast<size_t>(*PLD(res).size), false);
+    int num = mis.readInt();
+    for (int i = 0; i < num; i++) {
+        MemoryBlock settings;
+        int settingsSize = mis.readInt();
+        if (settingsSize > 0) {
+            mis.readIntoMemoryBlock(settings, settingsSize);
         }
-        return true;
+        ret.push_back(std::move(settings));
     }
-    return false;
+    return ret;
 }
 
 void Client::delPlugin(int idx) {
@@ -360,11 +664,16 @@ void Client::delPlugin(int idx) {
     Message<DelPlugin> msg;
     PLD(msg).setNumber(idx);
     dbglock(*this, 12);
+    clearParameterCache();  // plugin indices shift
     msg.send(m_cmd_socket.get());
-    auto result = MessageFactory::getResult(m_cmd_socket.get());
+    auto result = getCmdResult();
     if (nullptr != result && result->getReturnCode() > -1) {
         m_latency = result->getReturnCode();
     }
+    Message<ChainPrecision> prec;
+    if (readCmdMessage(prec)) {
+        m_serverChainFloatOnly = PLD(prec).getNumber() == 0;
+    }
 }
 
 void Client::editPlugin(int idx) {
@@ -398,7 +707,7 @@ MemoryBlock Client::getPluginSettings(int idx) {
         m_error = true;
     } else {
         Message<PluginSettings> res;
-        if (res.read(m_cmd_socket.get())) {
+        if (readCmdMessage(res)) {
             if (*res.payload.size > 0) {
                 block.append(res.payload.data, *res.payload.size);
             }
@@ -438,6 +747,7 @@ void Client::exchangePlugins(int idxA, int idxB) {
     DATA(msg)->idxA = idxA;
     DATA(msg)->idxB = idxB;
     dbglock(*this, 18);
+    clearParameterCache();  // plugin indices shift
     msg.send(m_cmd_socket.get());
 }
 
@@ -449,7 +759,7 @@ std::vector<ServerPlugin> Client::getRecents() {
     Message<RecentsList> msg;
     dbglock(*this, 19);
     msg.send(m_cmd_socket.get());
-    if (msg.read(m_cmd_socket.get())) {
+    if (readCmdMessage(msg)) {
         String listChunk(PLD(msg).str, *PLD(msg).size);
         auto list = StringArray::fromLines(listChunk);
         for (auto& line : list) {
@@ -464,6 +774,27 @@ std::vector<ServerPlugin> Client::getRecents() {
     return recents;
 }
 
+json Client::getProcTimes() {
+    json times = json::array();
+    if (!isReadyLockFree()) {
+        return times;
+    }
+    Message<ProcTimes> msg;
+    dbglock(*this, 29);
+    msg.send(m_cmd_socket.get());
+    if (readCmdMessage(msg)) {
+        try {
+            times = PLD(msg).getJson();
+        } catch (json::parse_error& e) {
+            logln(getLoadedPluginsString() << "parsing ProcTimes message failed: " << e.what());
+        }
+    } else {
+        logln(getLoadedPluginsString() << "failed to read ProcTimes message");
+        m_error = true;
+    }
+    return times;
+}
+
 void Client::setPreset(int idx, int preset) {
     if (!isReadyLockFree()) {
         return;
@@ -475,7 +806,24 @@ void Client::setPreset(int idx, int preset) {
     msg.send(m_cmd_socket.get());
 }
 
+void Client::cacheParameterValue(int idx, int paramIdx, float val) {
+    std::lock_guard<std::mutex> lock(m_paramValueCacheMtx);
+    m_paramValueCache[paramKey(idx, paramIdx)] = val;
+}
+
+void Client::clearParameterCache() {
+    std::lock_guard<std::mutex> lock(m_paramValueCacheMtx);
+    m_paramValueCache.clear();
+}
+
 float Client::getParameterValue(int idx, int paramIdx) {
+    {
+        std::lock_guard<std::mutex> lock(m_paramValueCacheMtx);
+        auto it = m_paramValueCache.find(paramKey(idx, paramIdx));
+        if (it != m_paramValueCache.end()) {
+            return it->second;
+        }
+    }
     if (!isReadyLockFree()) {
         return 0;
     };
@@ -485,8 +833,9 @@ float Client::getParameterValue(int idx, int paramIdx) {
     dbglock(*this, 21);
     msg.send(m_cmd_socket.get());
     Message<ParameterValue> ret;
-    if (ret.read(m_cmd_socket.get())) {
+    if (readCmdMessage(ret)) {
         if (DATA(msg)->idx == DATA(ret)->idx && DATA(msg)->paramIdx == DATA(ret)->paramIdx) {
+            cacheParameterValue(idx, paramIdx, DATA(ret)->value);
             return DATA(ret)->value;
         }
     }
@@ -499,6 +848,7 @@ void Client::setParameterValue(int idx, int paramIdx, float val) {
     if (!isReadyLockFree()) {
         return;
     };
+    cacheParameterValue(idx, paramIdx, val);
     Message<ParameterValue> msg;
     DATA(msg)->idx = idx;
     DATA(msg)->paramIdx = paramIdx;
@@ -507,26 +857,61 @@ void Client::setParameterValue(int idx, int paramIdx, float val) {
     msg.send(m_cmd_socket.get());
 }
 
+void Client::setParameterValues(const std::vector<parametervalue_t>& values) {
+    if (values.empty() || !isReadyLockFree()) {
+        return;
+    };
+    for (auto& val : values) {
+        cacheParameterValue(val.idx, val.paramIdx, val.value);
+    }
+    Message<ParameterValuesBatch> msg;
+    PLD(msg).setValues(values);
+    dbglock(*this, 26);
+    msg.send(m_cmd_socket.get());
+}
+
+std::shared_ptr<Image>& Client::ScreenReceiver::getFreeSlot() {
+    for (auto& slot : m_slots) {
+        // the client and the editor keep references to published frames, a use count of one means
+        // nobody looks at this slot anymore
+        if (slot == nullptr || slot.use_count() == 1) {
+            return slot;
+        }
+    }
+    // cannot happen, at most two frames are referenced outside at any time
+    return m_slots[0];
+}
+
 void Client::ScreenReceiver::run() {
-    using MsgType = Message<ScreenCapture>;
-    MsgType msg;
     MessageHelper::Error e;
     do {
-        if (msg.read(m_socket, &e, 200)) {
-            if (PLD(msg).hdr->size > 0) {
-                if (DATA(msg)[1] == 'P' && DATA(msg)[2] == 'N' && DATA(msg)[3] == 'G') {
-                    auto img = std::make_shared<Image>(PNGImageFormat::loadFrom(DATA(msg), PLD(msg).hdr->size));
-                    if (m_image == nullptr || m_image->getBounds() != img->getBounds()) {
-                        m_image = img;
-                    } else {
-                        ImageDiff::applyDelta(*m_image, *img);
+        auto anyMsg = std::make_shared<Message<Any>>();
+        if (anyMsg->read(m_socket, &e, 200)) {
+            switch (anyMsg->getType()) {
+                case ParameterValuesBatch::Type: {
+                    // value push from the remote editor UI, keep the cache current
+                    auto msgPv = Message<Any>::convert<ParameterValuesBatch>(anyMsg);
+                    int count = 0;
+                    auto* values = pPLD(msgPv).getValues(count);
+                    for (int i = 0; i < count; i++) {
+                        m_client->cacheParameterValue(values[i].idx, values[i].paramIdx, values[i].value);
                     }
-                } else {
-                    m_image = std::make_shared<Image>(JPEGImageFormat::loadFrom(DATA(msg), PLD(msg).hdr->size));
+                    break;
                 }
-                m_client->setPluginScreen(m_image, PLD(msg).hdr->width, PLD(msg).hdr->height);
-            } else {
-                m_client->setPluginScreen(nullptr, 0, 0);
+                case ScreenCapture::Type:
+                    handleScreenCapture(anyMsg);
+                    break;
+                case ScreenChunk::Type:
+                    handleScreenChunk(anyMsg);
+                    break;
+                default:
+                    if (m_mux) {
+                        // a command reply, park it for the synchronous call waiting on it
+                        m_client->pushCmdReply(std::move(anyMsg));
+                    } else {
+                        logln_clnt(m_client,
+                                   "unexpected message type " << anyMsg->getType() << " on the screen channel");
+                    }
             }
         }
     } while (!currentThreadShouldExit() && (e == MessageHelper::E_NONE || e == MessageHelper::E_TIMEOUT));
@@ -535,6 +920,80 @@ void Client::ScreenReceiver::run() {
     logln_clnt(m_client, "screen receiver terminated");
 }
 
+// Reassembles a ScreenCapture frame from its mux chunks, the decode runs once the last chunk
+// landed.
+void Client::ScreenReceiver::handleScreenChunk(std::shared_ptr<Message<Any>> anyMsg) {
+    auto msgChunk = Message<Any>::convert<ScreenChunk>(anyMsg);
+    auto* hdr = pPLD(msgChunk).hdr;
+    if (hdr->offset == 0) {
+        m_muxFrame = std::make_shared<Message<Any>>();
+        m_muxFrame->payload.setType(ScreenCapture::Type);
+        m_muxFrame->payload.setSize(hdr->frameSize);
+    }
+    if (nullptr == m_muxFrame || hdr->frameSize != m_muxFrame->payload.getSize() ||
+        hdr->offset + hdr->size > hdr->frameSize) {
+        return;  // out of sync, wait for the next frame start
+    }
+    memcpy(m_muxFrame->payload.getData() + hdr->offset, pPLD(msgChunk).data, hdr->size);
+    if (hdr->offset + hdr->size == hdr->frameSize) {
+        handleScreenCapture(std::move(m_muxFrame));
+    }
+}
+
+void Client::ScreenReceiver::handleScreenCapture(std::shared_ptr<Message<Any>> anyMsg) {
+    auto msgPtr = Message<Any>::convert<ScreenCapture>(anyMsg);
+    auto& msg = *msgPtr;
+    auto* hdr = PLD(msg).hdr;
+    if (hdr->numTiles > 0) {
+        // tiled update, decode into a free slot so the frame on screen stays untouched
+        auto& slot = getFreeSlot();
+        if (slot == nullptr || slot->getWidth() != hdr->width || slot->getHeight() != hdr->height) {
+            slot = std::make_shared<Image>(Image::ARGB, hdr->width, hdr->height, true);
+        }
+        // carry the last frame over, the tiles only cover the changed areas
+        auto last = m_client->getPluginScreen();
+        if (last != nullptr && last != slot && last->getWidth() == hdr->width &&
+            last->getHeight() == hdr->height) {
+            const Image::BitmapData bdFrom(*last, 0, 0, hdr->width, hdr->height);
+            Image::BitmapData bdTo(*slot, 0, 0, hdr->width, hdr->height, Image::BitmapData::writeOnly);
+            for (int l = 0; l < hdr->height; l++) {
+                memcpy(bdTo.getLinePointer(l), bdFrom.getLinePointer(l),
+                       (size_t)hdr->width * bdTo.pixelStride);
+            }
+        }
+        Graphics g(*slot);
+        auto* ptr = DATA(msg);
+        auto* end = ptr + hdr->size;
+        for (int i = 0; i < hdr->numTiles && ptr + sizeof(ScreenCapture::tile_t) <= end; i++) {
+            auto* tile = reinterpret_cast<const ScreenCapture::tile_t*>(ptr);
+            ptr += sizeof(ScreenCapture::tile_t);
+            if (hdr->codec == ScreenCapture::CODEC_RAW_GZ) {
+                // raw ARGB rows, decompress straight into the screen image
+                MemoryInputStream mis(ptr, tile->size, false);
+                GZIPDecompressorInputStream gz(&mis, false);
+                Image::BitmapData bd(*slot, tile->x, tile->y, tile->width, tile->height,
+                                     Image::BitmapData::writeOnly);
+                for (int l = 0; l < tile->height; l++) {
+                    gz.read(bd.getLinePointer(l), tile->width * bd.pixelStride);
+                }
+            } else {
+                auto img = PNGImageFormat::loadFrom(ptr, tile->size);
+                if (img.isValid()) {
+                    g.drawImageAt(img, tile->x, tile->y);
+                }
+            }
+            ptr += tile->size;
+        }
+        m_client->setPluginScreen(slot, hdr->width, hdr->height);
+    } else if (hdr->size > 0) {
+        auto& slot = getFreeSlot();
+        slot = std::make_shared<Image>(JPEGImageFormat::loadFrom(DATA(msg), hdr->size));
+        m_client->setPluginScreen(slot, hdr->width, hdr->height);
+    } else {
+        m_client->setPluginScreen(nullptr, 0, 0);
+    }
+}
+
 void Client::mouseMove(const MouseEvent& event) {
     sendMouseEvent(MouseEvType::MOVE, event.position, event.mods.isShiftDown(), event.mods.isCtrlDown(),
                    event.mods.isAltDown());
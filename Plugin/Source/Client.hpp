@@ -9,11 +9,16 @@
 #define Client_hpp
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "AudioConvert.hpp"
 #include "Message.hpp"
 #include "ServerPlugin.hpp"
 #include "Defaults.hpp"
 
 #include <boost/lockfree/spsc_queue.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
 
 #if (JUCE_DEBUG && !JUCE_DISABLE_ASSERTIONS)
 #define dbgln(M)                                                                                \
@@ -72,6 +77,23 @@ class Client : public Thread, public MouseListener, public KeyListener {
             return p;
         }
 
+        // packed record of the ChainSnapshot reply, see Worker::writeParameters
+        static Parameter fromStream(MemoryInputStream& mis) {
+            Parameter p;
+            p.idx = mis.readInt();
+            p.defaultValue = mis.readFloat();
+            p.category = static_cast<AudioProcessorParameter::Category>(mis.readInt());
+            p.numSteps = mis.readInt();
+            auto flags = static_cast<uint8>(mis.readByte());
+            p.isBoolean = flags & 1;
+            p.isDiscrete = flags & (1 << 1);
+            p.isMeta = flags & (1 << 2);
+            p.isOrientInv = flags & (1 << 3);
+            p.name = mis.readString();
+            p.label = mis.readString();
+            return p;
+        }
+
         json toJson() const {
             json j = {{"idx", idx},
                       {"name", name.toStdString()},
@@ -100,12 +122,72 @@ class Client : public Thread, public MouseListener, public KeyListener {
     int getChannels() const { return m_channels; }
     double getSampleRate() const { return m_rate; }
     int getSamplesPerBlock() const { return m_samplesPerBlock; }
-    int getLatencySamples() const { return m_latency + NUM_OF_BUFFERS * m_samplesPerBlock; }
+    int getLatencySamples() const {
+        // the adaptive controller in the streamer moves the effective depth with the measured
+        // network jitter, the DAW re-compensates through the processBlock latency check
+        int numBuffers = m_effBuffers > 0 ? m_effBuffers.load() : getNumBuffers();
+        return m_latency + numBuffers * m_samplesPerBlock;
+    }
+    // stream health counters for the plugin UI: missed read deadlines and stale blocks dropped
+    uint32_t getXruns() const { return m_xruns; }
+    uint32_t getDrops() const { return m_drops; }
+
+    // EWMA smoothed round trip breakdown in milliseconds, fed per block by the audio streamer
+    // from the timestamps echoed in the response header, read by the editor status line. The
+    // wire legs are corrected by an NTP style clock offset estimate and assume symmetric paths.
+    struct LatencyBreakdown {
+        std::atomic<double> queueMs{0.0};     // wait in the plugin's send queue
+        std::atomic<double> wireUpMs{0.0};    // client -> server network
+        std::atomic<double> srvQueueMs{0.0};  // wait for the worker's DSP slot
+        std::atomic<double> dspMs{0.0};       // chain processing
+        std::atomic<double> wireDownMs{0.0};  // server -> client network incl. the send handoff
+        std::atomic<double> totalMs{0.0};     // full round trip as the client sees it
+    };
+    const LatencyBreakdown& getLatencyBreakdown() const { return m_latencyBreakdown; }
+    // true when the server re-attached the chain of the previous connection, the onConnect
+    // handler skips the chain restore in that case
+    bool isSessionResumed() const { return m_sessionResumed; }
+
+    // Effective pipelining window. Offline renders are not latency sensitive, so they get a much
+    // wider window and the server processes back-to-back instead of in RTT-bound lockstep.
+    int getNumBuffers() const { return m_nonRealtime ? jmax(NUM_OF_BUFFERS, DEFAULT_NUM_OF_BUFFERS_OFFLINE) : NUM_OF_BUFFERS; }
+
+    void setNonRealtime(bool nonRealtime) {
+        if (m_nonRealtime != nonRealtime) {
+            logln("switching to " << (nonRealtime ? "offline render" : "realtime") << " mode");
+            m_nonRealtime = nonRealtime;
+            reconnect();
+        }
+    }
 
     bool isReady();
     bool isReadyLockFree();
     void init(int channels, double rate, int samplesPerBlock, bool doublePrecission);
 
+    // Answer of a load probe against a single server of a group. The score orders servers for
+    // placement: the audio time a box already spends per block dominates, the worker count
+    // breaks ties between idle servers.
+    struct ServerLoadInfo {
+        bool available = false;
+        double rttMs = 0.0;
+        int workers = 0;
+        double procTimeMs = 0.0;
+        double score() const { return procTimeMs * 10 + workers; }
+    };
+    static ServerLoadInfo probeServer(const String& server, int port = DEFAULT_SERVER_PORT);
+
+    // A server that answered a discovery broadcast, scored like ServerLoadInfo with the RTT of
+    // the answer as tie breaker, so the list is sorted best choice first.
+    struct DiscoveredServer {
+        String server;  // host[:id], the format the server list uses
+        String name;    // hostname the server reported
+        double rttMs = 0.0;
+        int workers = 0;
+        double procTimeMs = 0.0;
+        double score() const { return procTimeMs * 10 + workers + rttMs / 10; }
+    };
+    static std::vector<DiscoveredServer> discoverServers(int timeoutMs = 500);
+
     void reconnect() { m_needsReconnect = true; }
     void close();
 
@@ -143,7 +225,7 @@ class Client : public Thread, public MouseListener, public KeyListener {
     }
 
     const auto& getPlugins() const { return m_plugins; }
-    Image getPluginScreen();  // create copy
+    std::shared_ptr<Image> getPluginScreen();  // latest complete frame, lock-free
     void setPluginScreen(std::shared_ptr<Image> img, int w, int h);
 
     using ScreenUpdateCallback = std::function<void(std::shared_ptr<Image>, int, int)>;
@@ -155,7 +237,23 @@ class Client : public Thread, public MouseListener, public KeyListener {
     using OnCloseCallback = std::function<void()>;
     void setOnCloseCallback(OnCloseCallback fn);
 
+    // One entry per plugin for the batched restore. The params going in carry the automation
+    // slot assignments to keep, presets/params coming out hold what the server reported.
+    struct AddPluginRequest {
+        String id;
+        String settings;
+        bool bypass = false;
+        bool ok = false;
+        StringArray presets;
+        Array<Parameter> params;
+    };
+
     bool addPlugin(String id, StringArray& presets, Array<Parameter>& params, String settings = "");
+    bool addPlugins(Array<AddPluginRequest>& requests);
+    std::vector<MemoryBlock> getChainSettings();
+    // lazily fetched after AddPlugin, so inserts return as soon as the latency is known
+    StringArray getPresets(int idx);
+    Array<Parameter> getParameters(int idx);
     void delPlugin(int idx);
     void editPlugin(int idx);
     void hidePlugin();
@@ -164,10 +262,13 @@ class Client : public Thread, public MouseListener, public KeyListener {
     void unbypassPlugin(int idx);
     void exchangePlugins(int idxA, int idxB);
     std::vector<ServerPlugin> getRecents();
+    // per-plugin processing times of the server chain (see ProcessorChain::getProcTimes)
+    json getProcTimes();
     void setPreset(int idx, int preset);
 
     float getParameterValue(int idx, int paramIdx);
     void setParameterValue(int idx, int paramIdx, float val);
+    void setParameterValues(const std::vector<parametervalue_t>& values);
 
     // MouseListener
     void mouseMove(const MouseEvent& event) override;
@@ -195,7 +296,25 @@ class Client : public Thread, public MouseListener, public KeyListener {
     double m_rate = 0;
     int m_samplesPerBlock = 0;
     bool m_doublePrecission = false;
+    int m_audioFlags = 0;  // AUDIO_WIRE_*, negotiated via the handshake
+    bool m_liveMode = false;      // bounded read deadline per block, dry signal on a miss
+    int m_liveMaxBlockAgeMs = 0;  // live mode stale block limit, 0 = derive from the pipelining depth
+    String m_captureStreamPath;   // path prefix for stream captures (see StreamCapture), empty = off
+    int m_clientPort = 0;         // port of the listener the server dials back to
+    bool m_nonRealtime = false;
+    std::atomic<uint32_t> m_xruns{0};
+    std::atomic<uint32_t> m_drops{0};
+    LatencyBreakdown m_latencyBreakdown;
     int m_latency = 0;
+    // effective pipelining depth managed by the streamer's jitter controller, 0 when no
+    // adaptive streamer is active and the configured window applies
+    std::atomic<int> m_effBuffers{0};
+    // precision feedback from the ChainSnapshot/DelPlugin replies, when set the double streamer
+    // sends floats on the wire since the chain processes in single precision anyways
+    std::atomic_bool m_serverChainFloatOnly{false};
+    // random token sent with the handshake, lets the server hold the chain across reconnects
+    uint32 m_sessionToken = 0;
+    std::atomic_bool m_sessionResumed{false};
 
     std::mutex m_clientMtx;
     int m_clientMtxId = 0;
@@ -204,30 +323,112 @@ class Client : public Thread, public MouseListener, public KeyListener {
     std::unique_ptr<StreamingSocket> m_cmd_socket;
     std::unique_ptr<StreamingSocket> m_audio_socket;
     std::unique_ptr<StreamingSocket> m_screen_socket;
+    // same-host zero-copy transport, active when the server runs on localhost
+    SharedMemoryRing m_shmUp, m_shmDown;
+    // datagram audio transport for the LAN mode, the TCP audio socket stays for liveness
+    std::unique_ptr<DatagramSocket> m_audio_udp;
+    String m_udpPeerHost;
+    int m_udpPeerPort = 0;
     std::vector<ServerPlugin> m_plugins;
 
+    // plugin list cache shared by all plugin instances in the process, keyed by server, so a
+    // project with many instances transfers the list only once per server revision
+    struct PluginListCacheEntry {
+        uint32 hash = 0;
+        std::vector<ServerPlugin> plugins;
+    };
+    static HashMap<String, PluginListCacheEntry> m_pluginListCache;
+    static std::mutex m_pluginListCacheMtx;
+
+    // last known parameter values, fed by own sets and by pushes from the server while the
+    // remote editor is open, so getParameterValue is a memory lookup instead of a round trip
+    std::unordered_map<uint64_t, float> m_paramValueCache;
+    std::mutex m_paramValueCacheMtx;
+
+    static uint64_t paramKey(int idx, int paramIdx) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(idx)) << 32) | static_cast<uint32_t>(paramIdx);
+    }
+    void cacheParameterValue(int idx, int paramIdx, float val);
+    void clearParameterCache();
+
     class ScreenReceiver : public Thread {
       public:
-        ScreenReceiver(Client* clnt, StreamingSocket* sock) : Thread("ScreenWorker"), m_client(clnt), m_socket(sock) {}
-        ~ScreenReceiver() { stopThread(100); }
+        // without mux this reads the dedicated screen socket, with mux it is the pump owning
+        // all reads on the command socket: screen traffic gets handled here, command replies
+        // get parked in the client's reply queue for the synchronous command calls
+        ScreenReceiver(Client* clnt, StreamingSocket* sock, bool mux = false)
+            : Thread("ScreenWorker"), m_client(clnt), m_socket(sock), m_mux(mux) {}
+        ~ScreenReceiver() { stopThread(1000); }
         void run();
 
       private:
         Client* m_client;
         StreamingSocket* m_socket;
-        std::shared_ptr<Image> m_image;
+        bool m_mux;
+        std::shared_ptr<Message<Any>> m_muxFrame;  // ScreenCapture under reassembly from chunks
+
+        void handleScreenCapture(std::shared_ptr<Message<Any>> anyMsg);
+        void handleScreenChunk(std::shared_ptr<Message<Any>> anyMsg);
+        // triple buffer: the decoder writes into a free slot while the published frame and the one
+        // the editor still displays stay untouched, so neither side needs a lock or a copy
+        std::shared_ptr<Image> m_slots[3];
+
+        std::shared_ptr<Image>& getFreeSlot();
     };
 
     friend ScreenReceiver;
 
     std::unique_ptr<ScreenReceiver> m_screenWorker;
-    std::shared_ptr<Image> m_pluginScreen;
+    std::shared_ptr<Image> m_pluginScreen;  // latest complete frame, exchanged atomically
     ScreenUpdateCallback m_pluginScreenUpdateCallback;
-    std::mutex m_pluginScreenMtx;
+    std::mutex m_pluginScreenMtx;  // guards the callback only, not the image
 
     OnConnectCallback m_onConnectCallback;
     OnCloseCallback m_onCloseCallback;
 
+    // mux mode (WIRE_MUX): no dedicated screen connection, the screen stream shares the command
+    // socket; the pump (ScreenReceiver) owns all reads on it and parks command replies here
+    std::atomic_bool m_muxed{false};
+    std::deque<std::shared_ptr<Message<Any>>> m_cmdReplies;
+    std::mutex m_cmdRepliesMtx;
+    std::condition_variable m_cmdRepliesCv;
+
+    void pushCmdReply(std::shared_ptr<Message<Any>> msg) {
+        std::lock_guard<std::mutex> lock(m_cmdRepliesMtx);
+        m_cmdReplies.push_back(std::move(msg));
+        m_cmdRepliesCv.notify_all();
+    }
+
+    // Reads the reply to a command. Without mux this reads the command socket directly, with
+    // mux it pops the next reply parked by the pump.
+    template <typename T>
+    bool readCmdMessage(Message<T>& msg, MessageHelper::Error* e = nullptr, int timeoutMilliseconds = 1000) {
+        if (!m_muxed) {
+            return msg.read(m_cmd_socket.get(), e, timeoutMilliseconds);
+        }
+        MessageHelper::seterr(e, MessageHelper::E_NONE);
+        std::unique_lock<std::mutex> lock(m_cmdRepliesMtx);
+        if (!m_cmdRepliesCv.wait_for(lock, std::chrono::milliseconds(timeoutMilliseconds),
+                                     [this] { return !m_cmdReplies.empty(); })) {
+            MessageHelper::seterr(e, MessageHelper::E_TIMEOUT);
+            return false;
+        }
+        auto reply = std::move(m_cmdReplies.front());
+        m_cmdReplies.pop_front();
+        lock.unlock();
+        if (reply->getType() != T::Type) {
+            logln("unexpected reply type " << reply->getType() << " instead of " << T::Type);
+            MessageHelper::seterr(e, MessageHelper::E_DATA);
+            return false;
+        }
+        msg.payload.payloadBuffer.swap(reply->payload.payloadBuffer);
+        msg.payload.realign();
+        msg.payload.afterRead();
+        return true;
+    }
+
+    std::shared_ptr<Result> getCmdResult();
+
     void quit();
     void init();
 
@@ -28,6 +28,12 @@ void PluginButton::paintButton(Graphics& g, bool shouldDrawButtonAsHighlighted,
     }
 
     lf.drawButtonText(g, *this, shouldDrawButtonAsHighlighted, shouldDrawButtonAsDown);
+
+    if (m_procTime.isNotEmpty()) {
+        g.setColour(findColour(TextButton::textColourOffId).withMultipliedAlpha(0.5f));
+        g.setFont(Font(10, Font::plain));
+        g.drawText(m_procTime, getLocalBounds().reduced(4, 0), Justification::centredRight, false);
+    }
 }
 
 void PluginButton::clicked(const ModifierKeys& modifiers) {
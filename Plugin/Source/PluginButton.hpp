@@ -24,6 +24,14 @@ class PluginButton : public TextButton {
     void setOnClickWithModListener(Listener* p) { m_listener = p; }
     void setActive(bool b) { m_active = b; }
 
+    // processing time of the plugin on the server, drawn right aligned next to the name
+    void setProcTime(const String& s) {
+        if (s != m_procTime) {
+            m_procTime = s;
+            repaint();
+        }
+    }
+
     const String& getPluginId() const { return m_id; }
 
   protected:
@@ -34,6 +42,7 @@ class PluginButton : public TextButton {
     Listener* m_listener = nullptr;
     bool m_active = false;
     String m_id;
+    String m_procTime;
 };
 
 #endif /* PluginButton_hpp */
@@ -44,6 +44,13 @@ AudioGridderAudioProcessorEditor::AudioGridderAudioProcessorEditor(AudioGridderA
     m_versionLabel.setFont(Font(10, Font::plain));
     m_versionLabel.setAlpha(0.4);
 
+    addAndMakeVisible(m_statusLabel);
+    m_statusLabel.setJustificationType(Justification::centredRight);
+    m_statusLabel.setBounds(35, 89, 160, 10);
+    m_statusLabel.setFont(Font(10, Font::plain));
+    m_statusLabel.setAlpha(0.4);
+    startTimer(500);
+
     addAndMakeVisible(m_newPluginButton);
     m_newPluginButton.setButtonText("+");
     m_newPluginButton.setOnClickWithModListener(this);
@@ -105,6 +112,41 @@ void AudioGridderAudioProcessorEditor::resized() {
         setSize(windowWidth, windowHeight);
     }
     m_versionLabel.setBounds(0, windowHeight - 11, m_versionLabel.getWidth(), m_versionLabel.getHeight());
+    m_statusLabel.setBounds(windowWidth - 165, windowHeight - 11, 160, 10);
+}
+
+void AudioGridderAudioProcessorEditor::timerCallback() {
+    auto& client = m_processor.getClient();
+    auto xruns = client.getXruns();
+    auto drops = client.getDrops();
+    String status;
+    if (m_connected) {
+        auto& bd = client.getLatencyBreakdown();
+        if (bd.totalMs > 0.0) {
+            status << "q " << String(bd.queueMs.load(), 1) << "  net "
+                   << String(bd.wireUpMs.load() + bd.wireDownMs.load(), 1) << "  dsp " << String(bd.dspMs.load(), 1)
+                   << "  rt " << String(bd.totalMs.load(), 1) << " ms";
+        }
+        if (xruns > 0 || drops > 0) {
+            if (status.isNotEmpty()) {
+                status << "  ";
+            }
+            status << "xruns: " << (int64)xruns << "  drops: " << (int64)drops;
+        }
+    }
+    m_statusLabel.setText(status, NotificationType::dontSendNotification);
+
+    // per-plugin processing times, polled at a lower rate since it is a server round trip
+    if (++m_timerTicks % 4 == 0 && m_connected && !m_pluginButtons.empty()) {
+        auto times = m_processor.getClient().getProcTimes();
+        for (size_t i = 0; i < m_pluginButtons.size(); i++) {
+            String procTime;
+            if (i < times.size()) {
+                procTime << String(times[i]["avgMs"].get<double>(), 2) << " ms";
+            }
+            m_pluginButtons[i]->setProcTime(procTime);
+        }
+    }
 }
 
 void AudioGridderAudioProcessorEditor::buttonClicked(Button* button, const ModifierKeys& modifiers) {
@@ -169,7 +211,10 @@ void AudioGridderAudioProcessorEditor::buttonClicked(Button* button, const Modif
                             auto p = dynamic_cast<AudioGridderAudioProcessorEditor*>(p_processor->getActiveEditor());
                             if (this == p) {  // make sure the editor hasn't been closed
                                 m_pluginScreen.setSize(width, height);
-                                m_pluginScreen.setImage(img->createCopy());
+                                // keep the slot referenced while it is on screen, no copy; the
+                                // old reference is dropped after the component let go of its image
+                                m_pluginScreen.setImage(*img);
+                                m_screenImage = img;
                                 resized();
                             }
                         });
@@ -179,6 +224,7 @@ void AudioGridderAudioProcessorEditor::buttonClicked(Button* button, const Modif
                             if (this == p && m_pluginButtons.size() > idx) {
                                 m_processor.hidePlugin(false);
                                 m_pluginButtons[idx]->setActive(false);
+                                m_screenImage.reset();
                                 resized();
                             }
                         });
@@ -247,6 +293,7 @@ void AudioGridderAudioProcessorEditor::buttonClicked(Button* button, const Modif
                 resized();
             });
             m.addSeparator();
+            m_processor.ensurePluginMeta(idx);  // in case the background fetch did not finish
             PopupMenu presets;
             int preset = 0;
             for (auto& p : m_processor.getLoadedPlugin(idx).presets) {
@@ -389,6 +436,8 @@ void AudioGridderAudioProcessorEditor::mouseUp(const MouseEvent& event) {
         } else {
             PopupMenu srvMenu;
             srvMenu.addItem("Connect", [this, i] { m_processor.setActiveServer(i); });
+            srvMenu.addItem("Migrate Chain Here", m_processor.getLoadedPlugins().size() > 0,
+                            false, [this, i] { m_processor.migrateToServer(i); });
             srvMenu.addItem("Remove", [this, i] { m_processor.delServer(i); });
             m.addSubMenu(servers[i], srvMenu);
         }
@@ -400,5 +449,30 @@ void AudioGridderAudioProcessorEditor::mouseUp(const MouseEvent& event) {
         w->setAlwaysOnTop(true);
         w->runModalLoop();
     });
+    // discovered via broadcast, sorted so the lowest-latency least-loaded server comes first
+    auto discovered = m_processor.getDiscoveredServers();
+    bool haveHeader = false;
+    for (auto& srv : discovered) {
+        bool known = false;
+        for (auto& s : servers) {
+            known = known || !s.compare(srv.server);
+        }
+        if (known) {
+            continue;
+        }
+        if (!haveHeader) {
+            m.addSectionHeader("Discovered Servers");
+            haveHeader = true;
+        }
+        String label;
+        label << srv.server << " (" << srv.name << ", " << String(srv.rttMs, 1) << "ms, " << srv.workers
+              << " chains)";
+        String addr = srv.server;
+        m.addItem(label, [this, addr] {
+            m_processor.addServer(addr);
+            m_processor.setActiveServer(static_cast<int>(m_processor.getServers().size()) - 1);
+        });
+    }
+    m.addItem("Rescan Network", [this] { m_processor.scanServers(); });
     m.showAt(&m_srvIcon);
 }
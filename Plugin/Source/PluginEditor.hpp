@@ -11,7 +11,7 @@
 #include "PluginButton.hpp"
 #include "PluginProcessor.hpp"
 
-class AudioGridderAudioProcessorEditor : public AudioProcessorEditor, public PluginButton::Listener {
+class AudioGridderAudioProcessorEditor : public AudioProcessorEditor, public PluginButton::Listener, private Timer {
   public:
     AudioGridderAudioProcessorEditor(AudioGridderAudioProcessor&);
     ~AudioGridderAudioProcessorEditor();
@@ -31,9 +31,14 @@ class AudioGridderAudioProcessorEditor : public AudioProcessorEditor, public Plu
     std::vector<std::unique_ptr<PluginButton>> m_pluginButtons;
     PluginButton m_newPluginButton;
     ImageComponent m_pluginScreen;
+    std::shared_ptr<Image> m_screenImage;  // keeps the displayed triple buffer slot referenced
     ImageComponent m_srvIcon;
     Label m_srvLabel, m_versionLabel;
+    Label m_statusLabel;  // stream health (xruns/drops), updated by the timer
     bool m_connected = false;
+    int m_timerTicks = 0;
+
+    void timerCallback() override;
 
     Button* addPluginButton(const String& id, const String& name);
     std::vector<Button*> getPluginButtons(const String& id);
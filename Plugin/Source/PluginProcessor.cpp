@@ -8,6 +8,7 @@
 #include "PluginProcessor.hpp"
 
 #include <signal.h>
+#include <thread>
 
 #include "PluginEditor.hpp"
 #include "json.hpp"
@@ -62,18 +63,35 @@ AudioGridderAudioProcessor::AudioGridderAudioProcessor()
         addParameter(new Parameter(*this, i));
     }
 
-    // load plugins on reconnect
+    // load plugins on reconnect, the whole chain goes out as one snapshot so the restore does
+    // not pay a round trip per plugin
     m_client.setOnConnectCallback([this] {
+        if (m_client.isSessionResumed()) {
+            // the server kept the chain of the previous connection alive, just resume streaming
+            logln_clnt(&m_client, "session resumed, skipping chain restore");
+            setLatencySamples(m_client.getLatencySamples());
+            MessageManager::callAsync([this] {
+                auto* editor = getActiveEditor();
+                if (editor != nullptr) {
+                    dynamic_cast<AudioGridderAudioProcessorEditor*>(editor)->setConnected(true);
+                }
+            });
+            return;
+        }
+        Array<e47::Client::AddPluginRequest> requests;
+        for (auto& p : m_loadedPlugins) {
+            requests.add({p.id, p.settings, p.bypassed, false, {}, p.params});
+        }
+        m_client.addPlugins(requests);
         int idx = 0;
         for (auto& p : m_loadedPlugins) {
-            p.ok = m_client.addPlugin(p.id, p.presets, p.params, p.settings);
+            auto& req = requests.getReference(idx);
+            p.ok = req.ok;
             logln_clnt(&m_client, "loading " << p.name << " (" << p.id << ")... " << (p.ok ? "ok" : "failed"));
             if (p.ok) {
+                // presets/params restored from the saved state, fresh metadata gets fetched lazily
                 logln_clnt(&m_client, "updating latency samples to " << m_client.getLatencySamples());
                 setLatencySamples(m_client.getLatencySamples());
-                if (p.bypassed) {
-                    m_client.bypassPlugin(idx);
-                }
                 for (auto& p : p.params) {
                     if (p.automationSlot > -1) {
                         if (p.automationSlot < m_numberOfAutomationSlots) {
@@ -105,11 +123,111 @@ AudioGridderAudioProcessor::AudioGridderAudioProcessor()
     if (m_activeServer > -1 && m_activeServer < m_servers.size()) {
         m_client.setServer(m_servers[m_activeServer]);
     }
+    if (m_servers.size() > 1) {
+        autoPlaceServer();
+    }
+    scanServers();
+}
+
+// Broadcasts a discovery query in the background and keeps the answers for the server menu. An
+// instance without any configured server connects to the best discovered one right away.
+void AudioGridderAudioProcessor::scanServers() {
+    runBackgroundJob([this, alive = m_alive] {
+        auto found = e47::Client::discoverServers();
+        if (!*alive) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_discoveredServersMtx);
+            m_discoveredServers = found;
+        }
+        if (!found.empty()) {
+            MessageManager::callAsync([this, found, alive] {
+                if (!*alive) {
+                    return;
+                }
+                if (m_servers.empty()) {
+                    logln_clnt(&m_client, "no server configured, using discovered server " << found[0].server);
+                    addServer(found[0].server);
+                    setActiveServer(0);
+                }
+            });
+        }
+    });
+}
+
+std::vector<e47::Client::DiscoveredServer> AudioGridderAudioProcessor::getDiscoveredServers() const {
+    std::lock_guard<std::mutex> lock(m_discoveredServersMtx);
+    return m_discoveredServers;
+}
+
+// Probes the configured servers in the background and connects this instance to the least
+// loaded one. Only fresh instances get placed, a chain restored from a saved project or a
+// server picked by the user meanwhile wins.
+void AudioGridderAudioProcessor::autoPlaceServer() {
+    int startServer = m_activeServer;
+    auto servers = m_servers;  // the probes run in the background, the UI might mutate the list meanwhile
+    runBackgroundJob([this, startServer, servers, alive = m_alive] {
+        int best = -1;
+        double bestScore = 0;
+        for (int i = 0; i < (int)servers.size() && *alive; i++) {
+            auto info = e47::Client::probeServer(servers[(size_t)i]);
+            if (!info.available) {
+                continue;
+            }
+            if (best < 0 || info.score() < bestScore) {
+                best = i;
+                bestScore = info.score();
+            }
+        }
+        if (best > -1) {
+            MessageManager::callAsync([this, best, startServer, alive] {
+                if (!*alive) {
+                    return;
+                }
+                if (m_loadedPlugins.empty() && m_activeServer == startServer && best != m_activeServer) {
+                    logln_clnt(&m_client, "placing instance on least loaded server " << m_servers[(size_t)best]);
+                    setActiveServer(best);
+                }
+            });
+        }
+    });
+}
+
+void AudioGridderAudioProcessor::migrateToServer(int idx) {
+    // pull a fresh state snapshot from the current server first, the onConnect handler restores
+    // the chain from it on the new box
+    if (m_client.isReadyLockFree()) {
+        auto chainSettings = m_client.getChainSettings();
+        for (int i = 0; i < (int)m_loadedPlugins.size() && i < (int)chainSettings.size(); i++) {
+            if (chainSettings[(size_t)i].getSize() > 0) {
+                m_loadedPlugins[(size_t)i].settings = chainSettings[(size_t)i].toBase64Encoding();
+            }
+        }
+    }
+    setActiveServer(idx);
 }
 
 AudioGridderAudioProcessor::~AudioGridderAudioProcessor() {
+    *m_alive = false;  // neutralizes message thread callbacks still queued by background jobs
     m_client.signalThreadShouldExit();
-    m_client.close();
+    m_client.close();  // aborts the round trips of jobs still in flight, so the joins are quick
+    std::vector<std::thread> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_backgroundJobsMtx);
+        jobs.swap(m_backgroundJobs);
+    }
+    for (auto& job : jobs) {
+        job.join();
+    }
+}
+
+void AudioGridderAudioProcessor::runBackgroundJob(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(m_backgroundJobsMtx);
+    if (!*m_alive) {
+        return;
+    }
+    m_backgroundJobs.emplace_back(std::move(fn));
 }
 
 const String AudioGridderAudioProcessor::getName() const { return JucePlugin_Name; }
@@ -196,10 +314,23 @@ void AudioGridderAudioProcessor::processBlockReal(AudioBuffer<T>& buffer, MidiBu
     AudioPlayHead::CurrentPositionInfo posInfo;
     playHead->getCurrentPosition(posInfo);
 
+    // a bounce runs with a wider pipelining window, the switch reconnects in the background
+    m_client.setNonRealtime(isNonRealtime());
+
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i) {
         buffer.clear(i, 0, buffer.getNumSamples());
     }
 
+    if (m_localBypass.load(std::memory_order_relaxed)) {
+        // nothing on the chain would touch the audio, pass through locally instead of paying the
+        // round trip for a no-op; the command and screen connections stay up and streaming resumes
+        // once a plugin gets added or unbypassed
+        if (getLatencySamples() != 0) {
+            setLatencySamples(0);
+        }
+        return;
+    }
+
     if (!m_client.isReadyLockFree()) {
         for (auto i = 0; i < buffer.getNumChannels(); ++i) {
             buffer.clear(i, 0, buffer.getNumSamples());
@@ -229,14 +360,16 @@ void AudioGridderAudioProcessor::getStateInformation(MemoryBlock& destData) {
     j["version"] = 2;
     j["servers"] = jservers;
     j["activeServer"] = m_activeServer;
+    // one round trip for the settings of the whole chain instead of one per plugin
+    std::vector<MemoryBlock> chainSettings;
+    if (m_client.isReadyLockFree()) {
+        chainSettings = m_client.getChainSettings();
+    }
     auto jplugs = json::array();
     for (int i = 0; i < m_loadedPlugins.size(); i++) {
         auto& plug = m_loadedPlugins[i];
-        if (m_client.isReadyLockFree()) {
-            auto settings = m_client.getPluginSettings(static_cast<int>(i));
-            if (settings.getSize() > 0) {
-                plug.settings = settings.toBase64Encoding();
-            }
+        if (i < (int)chainSettings.size() && chainSettings[(size_t)i].getSize() > 0) {
+            plug.settings = chainSettings[(size_t)i].toBase64Encoding();
         }
         auto jpresets = json::array();
         for (auto& p : plug.presets) {
@@ -321,6 +454,7 @@ void AudioGridderAudioProcessor::setStateInformation(const void* data, int sizeI
                 }
             }
         }
+        updateLocalBypass();
         if (m_activeServer > -1 && m_activeServer < m_servers.size()) {
             m_client.setServer(m_servers[m_activeServer]);
             m_client.reconnect();
@@ -360,10 +494,57 @@ bool AudioGridderAudioProcessor::loadPlugin(const String& id, const String& name
         logln_clnt(&m_client, "updating latency samples to " << m_client.getLatencySamples());
         setLatencySamples(m_client.getLatencySamples());
         m_loadedPlugins.push_back({id, name, "", presets, params, false, true});
+        updateLocalBypass();
+        fetchPluginMetaAsync(static_cast<int>(m_loadedPlugins.size()) - 1);
     }
     return success;
 }
 
+void AudioGridderAudioProcessor::applyPluginMeta(int idx, const StringArray& presets,
+                                                 Array<e47::Client::Parameter>& params) {
+    if (idx < 0 || idx >= (int)m_loadedPlugins.size()) {
+        return;
+    }
+    auto& plug = m_loadedPlugins[(size_t)idx];
+    // keep automation slots assigned in the meantime
+    for (auto& newParam : params) {
+        for (auto& oldParam : plug.params) {
+            if (newParam.idx == oldParam.idx) {
+                newParam.automationSlot = oldParam.automationSlot;
+                break;
+            }
+        }
+    }
+    plug.presets = presets;
+    plug.params = std::move(params);
+}
+
+void AudioGridderAudioProcessor::fetchPluginMetaAsync(int idx) {
+    runBackgroundJob([this, idx, alive = m_alive] {
+        auto presets = m_client.getPresets(idx);
+        auto params = m_client.getParameters(idx);
+        MessageManager::callAsync([this, idx, presets, params, alive]() mutable {
+            if (!*alive) {
+                return;
+            }
+            applyPluginMeta(idx, presets, params);
+        });
+    });
+}
+
+void AudioGridderAudioProcessor::ensurePluginMeta(int idx) {
+    if (idx < 0 || idx >= (int)m_loadedPlugins.size()) {
+        return;
+    }
+    auto& plug = m_loadedPlugins[(size_t)idx];
+    if (!plug.ok || !plug.presets.isEmpty() || !plug.params.isEmpty()) {
+        return;
+    }
+    auto presets = m_client.getPresets(idx);
+    auto params = m_client.getParameters(idx);
+    applyPluginMeta(idx, presets, params);
+}
+
 void AudioGridderAudioProcessor::unloadPlugin(int idx) {
     suspendProcessing(true);
     m_client.delPlugin(idx);
@@ -379,9 +560,10 @@ void AudioGridderAudioProcessor::unloadPlugin(int idx) {
     for (auto it = m_loadedPlugins.begin(); it < m_loadedPlugins.end(); it++) {
         if (i++ == idx) {
             m_loadedPlugins.erase(it);
-            return;
+            break;
         }
     }
+    updateLocalBypass();
 }
 
 void AudioGridderAudioProcessor::editPlugin(int idx) {
@@ -407,6 +589,7 @@ void AudioGridderAudioProcessor::bypassPlugin(int idx) {
     if (idx > -1 && idx < m_loadedPlugins.size()) {
         m_client.bypassPlugin(idx);
         m_loadedPlugins[idx].bypassed = true;
+        updateLocalBypass();
     }
 }
 
@@ -414,7 +597,22 @@ void AudioGridderAudioProcessor::unbypassPlugin(int idx) {
     if (idx > -1 && idx < m_loadedPlugins.size()) {
         m_client.unbypassPlugin(idx);
         m_loadedPlugins[idx].bypassed = false;
+        updateLocalBypass();
+    }
+}
+
+// The server round trip for a chain that does not touch the audio is pure waste, so
+// processBlockReal short-circuits while the chain is empty or fully bypassed. Updated on every
+// chain change, read lock free on the audio thread.
+void AudioGridderAudioProcessor::updateLocalBypass() {
+    bool bypass = true;
+    for (auto& plug : m_loadedPlugins) {
+        if (!plug.bypassed) {
+            bypass = false;
+            break;
+        }
     }
+    m_localBypass = bypass;
 }
 
 void AudioGridderAudioProcessor::exchangePlugins(int idxA, int idxB) {
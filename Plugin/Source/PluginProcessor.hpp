@@ -11,6 +11,7 @@
 #include "Client.hpp"
 
 #include <set>
+#include <thread>
 
 class AudioGridderAudioProcessor : public AudioProcessor {
   public:
@@ -82,11 +83,21 @@ class AudioGridderAudioProcessor : public AudioProcessor {
     bool enableParamAutomation(int idx, int paramIdx, int slot = -1);
     void disableParamAutomation(int idx, int paramIdx);
 
+    // presets and parameter metadata get fetched lazily after an insert, in the background for
+    // new plugins and on demand when the UI needs them
+    void fetchPluginMetaAsync(int idx);
+    void ensurePluginMeta(int idx);
+
     auto& getServers() const { return m_servers; }
     void addServer(const String& s) { m_servers.push_back(s); }
     void delServer(int idx);
     int getActiveServer() const { return m_activeServer; }
     void setActiveServer(int i);
+    // moves the loaded chain to another server of the group without touching the DAW project
+    void migrateToServer(int idx);
+    // background discovery broadcast, results show up in the server menu sorted best first
+    void scanServers();
+    std::vector<e47::Client::DiscoveredServer> getDiscoveredServers() const;
 
     int getLatencyMillis() const { return m_client.NUM_OF_BUFFERS * getBlockSize() * 1000 / getSampleRate(); }
 
@@ -126,13 +137,33 @@ class AudioGridderAudioProcessor : public AudioProcessor {
   private:
     e47::Client m_client;
     std::vector<LoadedPlugin> m_loadedPlugins;
+    // true while the chain is empty or fully bypassed, processBlockReal passes audio through
+    // locally then instead of paying the server round trip for a no-op
+    std::atomic_bool m_localBypass{true};
     int m_activePlugin = -1;
     std::vector<String> m_servers;
     int m_activeServer = 0;
+    std::vector<e47::Client::DiscoveredServer> m_discoveredServers;
+    mutable std::mutex m_discoveredServersMtx;
 
     int m_numberOfAutomationSlots = 16;
     LoadedPlugin m_unusedDummyPlugin;
     e47::Client::Parameter m_unusedParam;
 
+    // Background jobs (discovery, placement probes, metadata fetches) run on owned threads that
+    // the destructor joins, a detached thread can outlive the instance. DAWs create and destroy
+    // instances within milliseconds while validating plugins, so that is not a theoretical race.
+    // m_alive guards the message thread callbacks the jobs queue: a callAsync can still be
+    // pending after the job thread has been joined.
+    std::vector<std::thread> m_backgroundJobs;
+    std::mutex m_backgroundJobsMtx;
+    std::shared_ptr<std::atomic_bool> m_alive = std::make_shared<std::atomic_bool>(true);
+
+    void runBackgroundJob(std::function<void()> fn);
+
+    void applyPluginMeta(int idx, const StringArray& presets, Array<e47::Client::Parameter>& params);
+    void updateLocalBypass();
+    void autoPlaceServer();
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioGridderAudioProcessor)
 };
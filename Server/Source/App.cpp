@@ -6,6 +6,8 @@
  */
 
 #include "App.hpp"
+#include "ProcessorChain.hpp"
+#include "Replay.hpp"
 #include "Server.hpp"
 #include "Utils.hpp"
 
@@ -16,19 +18,67 @@ namespace e47 {
 App::App() : m_menuWindow(this) {}
 
 void App::initialise(const String& commandLineParameters) {
+    auto args = getCommandLineParameterArray();
+    String fileToScan, formatToScan;
+    String replayFile, replayHost = "localhost", replayPlugins;
+    int replayPort = DEFAULT_SERVER_PORT;
+    double replaySpeed = 1.0;
+    for (int i = 0; i < args.size() - 1; i++) {
+        if (!args[i].compare("-scan")) {
+            fileToScan = args[i + 1];
+        } else if (!args[i].compare("-fmt")) {
+            formatToScan = args[i + 1];
+        } else if (!args[i].compare("-replay")) {
+            replayFile = args[i + 1];
+        } else if (!args[i].compare("-host")) {
+            replayHost = args[i + 1];
+        } else if (!args[i].compare("-port")) {
+            replayPort = args[i + 1].getIntValue();
+        } else if (!args[i].compare("-speed")) {
+            replaySpeed = args[i + 1].getDoubleValue();
+        } else if (!args[i].compare("-plugins")) {
+            replayPlugins = args[i + 1];
+        }
+    }
+    if (fileToScan.isNotEmpty()) {
+        // sandboxed scan mode, spawned by the server: scan a single plugin and report the result
+        // via stdout, a crashing plugin only takes down this process
+        setApplicationReturnValue(Server::scanPlugin(fileToScan, formatToScan) ? 0 : 1);
+        quit();
+        return;
+    }
+    if (replayFile.isNotEmpty()) {
+        // benchmark mode: stream a capture to a server and report the round trip distribution
+        StringArray plugs;
+        if (replayPlugins.isNotEmpty()) {
+            plugs = StringArray::fromTokens(replayPlugins, ",", "");
+        }
+        setApplicationReturnValue(Replay::run(replayFile, replayHost, replayPort, replaySpeed, plugs) ? 0 : 1);
+        quit();
+        return;
+    }
     m_logger = FileLogger::createDateStampedLogger(getApplicationName(), "Main_", ".log", "");
     Logger::setCurrentLogger(m_logger);
     signal(SIGPIPE, SIG_IGN);
     showSplashWindow();
     setSplashInfo("Starting server...");
     m_server = std::make_unique<Server>();
+    if (int cores = m_server->getAudioCores()) {
+        // the message thread hosts the plugin UIs, keep it off the audio cores
+        setCurrentThreadAffinity(ThreadGroup::HOUSEKEEPING, cores);
+    }
     m_server->startThread();
 }
 
 void App::shutdown() {
-    m_server->shutdown();
-    m_server->waitForThreadToExit(-1);
-    m_server.reset();
+    if (nullptr != m_server) {
+        m_server->shutdown();
+        m_server->waitForThreadToExit(-1);
+        m_server.reset();
+    }
+    // after the workers are gone nothing refills the pool, drop the warm instances while the
+    // message loop still exists, static deinitialization is too late for plugin teardown
+    ProcessorChain::clearWarmPool();
     Logger::setCurrentLogger(nullptr);
     delete m_logger;
 }
@@ -170,7 +170,7 @@ class App : public JUCEApplication, public MenuBarModel {
     std::shared_ptr<AudioProcessor> m_windowProc;
     WindowCaptureCallback m_windowFunc;
     std::mutex m_windowMtx;
-    FileLogger* m_logger;
+    FileLogger* m_logger = nullptr;
     MenuBarWindow m_menuWindow;
 };
 
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#ifndef AudioConvert_hpp
+#define AudioConvert_hpp
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace e47 {
+
+namespace AudioConvert {
+
+// Precision conversion kernels for the audio wire. AudioBuffer::makeCopyOf converts one sample
+// per iteration through a templated assignment that the compiler does not vectorize across the
+// float/double type boundary, with SSE2 we convert four samples per iteration instead.
+
+inline void convertSamples(float* dst, const double* src, int num) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= num; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+    }
+#endif
+    for (; i < num; i++) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+inline void convertSamples(double* dst, const float* src, int num) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= num; i += 4) {
+        __m128 v = _mm_loadu_ps(src + i);
+        _mm_storeu_pd(dst + i, _mm_cvtps_pd(v));
+        _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+#endif
+    for (; i < num; i++) {
+        dst[i] = static_cast<double>(src[i]);
+    }
+}
+
+inline void convert(AudioBuffer<float>& dst, const AudioBuffer<double>& src) {
+    dst.setSize(src.getNumChannels(), src.getNumSamples(), false, false, true);
+    for (int chan = 0; chan < src.getNumChannels(); chan++) {
+        convertSamples(dst.getWritePointer(chan), src.getReadPointer(chan), src.getNumSamples());
+    }
+}
+
+inline void convert(AudioBuffer<double>& dst, const AudioBuffer<float>& src) {
+    dst.setSize(src.getNumChannels(), src.getNumSamples(), false, false, true);
+    for (int chan = 0; chan < src.getNumChannels(); chan++) {
+        convertSamples(dst.getWritePointer(chan), src.getReadPointer(chan), src.getNumSamples());
+    }
+}
+
+// No-op variant so templated callers instantiate for the float streamer as well, the downgrade
+// branch guarding the call never runs there.
+inline void convert(AudioBuffer<float>& dst, const AudioBuffer<float>& src) { dst.makeCopyOf(src); }
+
+}  // namespace AudioConvert
+
+}  // namespace e47
+
+#endif /* AudioConvert_hpp */
@@ -7,6 +7,10 @@
 
 #include "AudioWorker.hpp"
 
+#include <unistd.h>
+
+#include "AudioConvert.hpp"
+#include "Defaults.hpp"
 #include "Message.hpp"
 #include "Utils.hpp"
 
@@ -15,6 +19,9 @@ namespace e47 {
 HashMap<String, AudioWorker::RecentsListType> AudioWorker::m_recents;
 std::mutex AudioWorker::m_recentsMtx;
 
+std::unordered_map<uint32, AudioWorker::ParkedChain> AudioWorker::m_parked;
+std::mutex AudioWorker::m_parkedMtx;
+
 AudioWorker::~AudioWorker() {
     if (nullptr != m_socket && m_socket->isConnected()) {
         m_socket->close();
@@ -23,87 +30,275 @@ AudioWorker::~AudioWorker() {
     stopThread(-1);
 }
 
-void AudioWorker::init(std::unique_ptr<StreamingSocket> s, int channels, double rate, int samplesPerBlock,
-                       bool doublePrecission, std::function<void()> fn) {
+void AudioWorker::init(std::unique_ptr<StreamingSocket> s, int clientPort, int channels, double rate,
+                       int samplesPerBlock, bool doublePrecission, int wireFlags, std::function<void()> fn) {
     m_socket = std::move(s);
     m_rate = rate;
     m_samplesPerBlock = samplesPerBlock;
     m_doublePrecission = doublePrecission;
+    m_wireFlags = wireFlags;
     m_onTerminate = fn;
+    if (m_wireFlags & AUDIO_WIRE_SHM) {
+        String base = "/ag." + String(clientPort);
+        if (m_shmUp.open(base + ".up") && m_shmDown.open(base + ".dn")) {
+            logln("using shared memory audio transport");
+        } else {
+            logln("failed to open shared memory rings, falling back to socket transport");
+            m_shmUp.close();
+            m_shmDown.close();
+            m_wireFlags &= ~AUDIO_WIRE_SHM;
+        }
+    }
+    if (m_wireFlags & AUDIO_WIRE_UDP) {
+        m_clientHost = m_socket->getHostName();
+        m_clientPort = clientPort;
+        m_udp = std::make_unique<DatagramSocket>();
+        uint32 magic = UDP_HELLO;
+        if (m_udp->bindToPort(0) &&
+            m_udp->write(m_clientHost, m_clientPort, &magic, sizeof(magic)) == sizeof(magic)) {
+            // announce a couple of times, the hello itself is a datagram and can get lost
+            m_udp->write(m_clientHost, m_clientPort, &magic, sizeof(magic));
+            m_udp->write(m_clientHost, m_clientPort, &magic, sizeof(magic));
+            logln("using UDP audio transport");
+        } else {
+            logln("failed to set up UDP audio transport, falling back to TCP");
+            m_udp.reset();
+            m_wireFlags &= ~AUDIO_WIRE_UDP;
+        }
+    }
     if (m_doublePrecission && m_chain->supportsDoublePrecisionProcessing()) {
         m_chain->setProcessingPrecision(AudioProcessor::doublePrecision);
     }
     m_channels = channels;
     m_chain->updateChannels(channels);
+    m_chain->setPipelineStages(getApp().getServer().getChainPipelineStages());
+    m_metrics = Metrics::createChannel(m_socket->getHostName() + ":" + String(clientPort));
+    auto capPath = getApp().getServer().getCaptureStreamPath();
+    if (capPath.isNotEmpty()) {
+        auto cap = std::make_unique<StreamCapture>();
+        String capFile = capPath + "." + String(clientPort) + ".agcap";
+        if (cap->open(capFile, channels, rate, samplesPerBlock)) {
+            logln("capturing audio request stream to " << capFile);
+            m_capture = std::move(cap);
+        } else {
+            logln("failed to open stream capture " << capFile);
+        }
+    }
 }
 
-void AudioWorker::run() {
-    AudioBuffer<float> bufferF;
-    AudioBuffer<double> bufferD;
-    MidiBuffer midi;
+bool AudioWorker::waitBlockFull(Block& block) {
+    int spins = 0;
+    while (!block.full) {
+        if (m_stop || ++spins > 20000) {  // roughly a second
+            return false;
+        }
+        usleep(50);
+    }
+    return !m_stop;
+}
+
+bool AudioWorker::waitBlockEmpty(Block& block) {
+    int spins = 0;
+    while (block.full) {
+        if (m_stop || ++spins > 20000) {
+            return false;
+        }
+        usleep(50);
+    }
+    return !m_stop;
+}
+
+void AudioWorker::Reader::run() {
+    if (int cores = getApp().getServer().getAudioCores()) {
+        setCurrentThreadAffinity(ThreadGroup::AUDIO, cores);
+    }
+    auto& w = m_worker;
     AudioMessage msg;
+    msg.setWireFlags(w.m_wireFlags);
+    if (nullptr != w.m_capture) {
+        msg.setCapture(w.m_capture.get());
+    }
+    bool shm = w.m_shmUp.isOpen();
+    while (!currentThreadShouldExit() && nullptr != w.m_socket && w.m_socket->isConnected()) {
+        if (!w.waitBlockEmpty(w.m_inBlock)) {
+            continue;
+        }
+        auto& block = w.m_inBlock;
+        auto start = Time::getHighResolutionTicks();
+        if (shm) {
+            // the socket stays open for liveness, blocks travel via shared memory
+            if (!msg.readFromClient(w.m_shmUp, block.bufferF, block.bufferD, block.midi, block.posInfo,
+                                    w.m_chain->getExtraChannels())) {
+                continue;  // timeout, check the socket and try again
+            }
+        } else if (nullptr != w.m_udp) {
+            if (!msg.readFromClient(*w.m_udp, block.bufferF, block.bufferD, block.midi, block.posInfo,
+                                    w.m_chain->getExtraChannels())) {
+                continue;  // timeout, check the socket and try again
+            }
+        } else {
+            if (!w.m_socket->waitUntilReady(true, 1000)) {
+                continue;
+            }
+            if (!msg.readFromClient(w.m_socket.get(), block.bufferF, block.bufferD, block.midi, block.posInfo,
+                                    w.m_chain->getExtraChannels())) {
+                w.m_socket->close();
+                break;
+            }
+        }
+        w.m_metrics->netRead.record(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000);
+        block.clientSentAt = msg.getClientSentAt();
+        block.receivedAt = Time::getMillisecondCounterHiRes();
+        block.channels = msg.getChannels();
+        block.samples = msg.getSamples();
+        block.isDouble = msg.isDouble();
+        block.full = true;
+    }
+}
+
+void AudioWorker::Sender::run() {
+    if (int cores = getApp().getServer().getAudioCores()) {
+        setCurrentThreadAffinity(ThreadGroup::AUDIO, cores);
+    }
+    auto& w = m_worker;
+    AudioMessage msg;
+    msg.setWireFlags(w.m_wireFlags);
+    if (nullptr != w.m_udp) {
+        msg.setUdpPeer(w.m_clientHost, w.m_clientPort);
+    }
+    bool shm = w.m_shmDown.isOpen();
+    while (!currentThreadShouldExit() && nullptr != w.m_socket && w.m_socket->isConnected()) {
+        if (!w.waitBlockFull(w.m_outBlock)) {
+            continue;
+        }
+        auto& block = w.m_outBlock;
+        msg.setFrame(block.channels, block.samples, block.isDouble);
+        msg.setTimestamps(block.clientSentAt, block.receivedAt, block.procStartAt, block.procEndAt);
+        auto start = Time::getHighResolutionTicks();
+        bool sendOk;
+        if (block.isDouble) {
+            sendOk = shm                ? msg.sendToClient(w.m_shmDown, block.bufferD, block.midi, block.latencySamples)
+                     : nullptr != w.m_udp ? msg.sendToClient(*w.m_udp, block.bufferD, block.midi, block.latencySamples)
+                                          : msg.sendToClient(w.m_socket.get(), block.bufferD, block.midi,
+                                                             block.latencySamples);
+        } else {
+            sendOk = shm                ? msg.sendToClient(w.m_shmDown, block.bufferF, block.midi, block.latencySamples)
+                     : nullptr != w.m_udp ? msg.sendToClient(*w.m_udp, block.bufferF, block.midi, block.latencySamples)
+                                          : msg.sendToClient(w.m_socket.get(), block.bufferF, block.midi,
+                                                             block.latencySamples);
+        }
+        w.m_metrics->netWrite.record(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) *
+                                     1000);
+        block.full = false;
+        if (!sendOk) {
+            logln("failed to send audio data to client");
+            w.m_socket->close();
+        }
+    }
+}
+
+void AudioWorker::run() {
+    // keep the DSP threads off the cores servicing the screen capturing and the message thread
+    if (int cores = getApp().getServer().getAudioCores()) {
+        setCurrentThreadAffinity(ThreadGroup::AUDIO, cores);
+    }
     AudioPlayHead::CurrentPositionInfo posInfo;
 
     ProcessorChain::PlayHead playHead(&posInfo);
     m_chain->prepareToPlay(m_rate, m_samplesPerBlock);
     m_chain->setPlayHead(&playHead);
 
+    m_stop = false;
+    Reader reader(*this);
+    Sender sender(*this);
+    reader.startThread(Thread::realtimeAudioPriority);
+    sender.startThread(Thread::realtimeAudioPriority);
+
     while (!currentThreadShouldExit() && nullptr != m_socket && m_socket->isConnected()) {
-        // Read audio chunk
-        if (m_socket->waitUntilReady(true, 1000)) {
-            if (msg.readFromClient(m_socket.get(), bufferF, bufferD, midi, posInfo, m_chain->getExtraChannels())) {
-                if (msg.isDouble() && bufferD.getNumChannels() > 0 && bufferD.getNumSamples() > 0) {
-                    if (m_channels > bufferD.getNumChannels()) {
-                        dbgln("updating bus layout at processing time due to channel mismatch");
-                        m_chain->releaseResources();
-                        if (!m_chain->updateChannels(bufferD.getNumChannels())) {
-                            logln("failed setting bus layout");
-                            m_socket->close();
-                            break;
-                        }
-                        m_channels = bufferD.getNumChannels();
-                        m_chain->prepareToPlay(m_rate, m_samplesPerBlock);
-                    }
-                    if (m_chain->supportsDoublePrecisionProcessing()) {
-                        m_chain->processBlock(bufferD, midi);
-                    } else {
-                        bufferF.makeCopyOf(bufferD);
-                        m_chain->processBlock(bufferF, midi);
-                        bufferD.makeCopyOf(bufferF);
-                    }
-                } else if (bufferF.getNumChannels() > 0 && bufferF.getNumSamples() > 0) {
-                    if (m_channels > bufferF.getNumChannels()) {
-                        dbgln("updating bus layout at processing time due to channel mismatch");
-                        m_chain->releaseResources();
-                        if (!m_chain->updateChannels(bufferF.getNumChannels())) {
-                            logln("failed setting bus layout");
-                            m_socket->close();
-                            break;
-                        }
-                        m_channels = bufferF.getNumChannels();
-                        m_chain->prepareToPlay(m_rate, m_samplesPerBlock);
-                    }
-                    m_chain->processBlock(bufferF, midi);
-                } else {
-                    logln("empty audio message from " << m_socket->getHostName());
-                }
-                if (msg.isDouble()) {
-                    if (!msg.sendToClient(m_socket.get(), bufferD, midi, m_chain->getLatencySamples())) {
-                        logln("failed to send audio data to client");
-                        m_socket->close();
-                    }
-                } else {
-                    if (!msg.sendToClient(m_socket.get(), bufferF, midi, m_chain->getLatencySamples())) {
-                        logln("failed to send audio data to client");
-                        m_socket->close();
-                    }
+        if (!m_inBlock.full) {
+            m_metrics->inStarved++;
+        }
+        if (!waitBlockFull(m_inBlock)) {
+            continue;
+        }
+        auto& block = m_inBlock;
+        auto startProc = Time::getHighResolutionTicks();
+        block.procStartAt = Time::getMillisecondCounterHiRes();
+        posInfo = block.posInfo;
+        if (block.isDouble && block.bufferD.getNumChannels() > 0 && block.bufferD.getNumSamples() > 0) {
+            if (m_channels > block.bufferD.getNumChannels()) {
+                dbgln("updating bus layout at processing time due to channel mismatch");
+                m_chain->releaseResources();
+                if (!m_chain->updateChannels(block.bufferD.getNumChannels())) {
+                    logln("failed setting bus layout");
+                    m_socket->close();
+                    break;
                 }
+                m_channels = block.bufferD.getNumChannels();
+                m_chain->prepareToPlay(m_rate, m_samplesPerBlock);
+            }
+            if (m_chain->supportsDoublePrecisionProcessing()) {
+                m_chain->processBlock(block.bufferD, block.midi);
             } else {
-                m_socket->close();
+                // the chain runs in single precision anyways, newer clients notice and stop
+                // sending doubles, for older ones convert around the block
+                AudioConvert::convert(block.bufferF, block.bufferD);
+                m_chain->processBlock(block.bufferF, block.midi);
+                AudioConvert::convert(block.bufferD, block.bufferF);
+            }
+        } else if (!block.isDouble && block.bufferF.getNumChannels() > 0 && block.bufferF.getNumSamples() > 0) {
+            if (m_channels > block.bufferF.getNumChannels()) {
+                dbgln("updating bus layout at processing time due to channel mismatch");
+                m_chain->releaseResources();
+                if (!m_chain->updateChannels(block.bufferF.getNumChannels())) {
+                    logln("failed setting bus layout");
+                    m_socket->close();
+                    break;
+                }
+                m_channels = block.bufferF.getNumChannels();
+                m_chain->prepareToPlay(m_rate, m_samplesPerBlock);
             }
+            m_chain->processBlock(block.bufferF, block.midi);
+        } else {
+            logln("empty audio message from " << m_socket->getHostName());
+        }
+        block.procEndAt = Time::getMillisecondCounterHiRes();
+        m_metrics->procTime.record(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startProc) *
+                                   1000);
+        m_metrics->blocks++;
+        // hand the result to the sender and free the input slot for the reader
+        if (m_outBlock.full) {
+            m_metrics->outBackpressure++;
         }
+        if (!waitBlockEmpty(m_outBlock)) {
+            block.full = false;
+            continue;
+        }
+        std::swap(m_outBlock.bufferF, block.bufferF);
+        std::swap(m_outBlock.bufferD, block.bufferD);
+        m_outBlock.midi.swapWith(block.midi);
+        m_outBlock.posInfo = block.posInfo;
+        m_outBlock.channels = block.channels;
+        m_outBlock.samples = block.samples;
+        m_outBlock.isDouble = block.isDouble;
+        m_outBlock.latencySamples = m_chain->getLatencySamples();
+        m_outBlock.clientSentAt = block.clientSentAt;
+        m_outBlock.receivedAt = block.receivedAt;
+        m_outBlock.procStartAt = block.procStartAt;
+        m_outBlock.procEndAt = block.procEndAt;
+        m_outBlock.full = true;
+        block.full = false;
     }
 
+    m_stop = true;
+    reader.stopThread(1000);
+    sender.stopThread(1000);
+
+    m_shmUp.close();
+    m_shmDown.close();
+    m_udp.reset();
+    m_capture.reset();  // finalizes the capture header
+
     clear();
 
     signalThreadShouldExit();
@@ -114,6 +309,7 @@ void AudioWorker::run() {
 }
 
 void AudioWorker::shutdown() {
+    m_stop = true;
     clear();
     signalThreadShouldExit();
 }
@@ -130,6 +326,49 @@ void AudioWorker::clear() {
     }
 }
 
+// Keeps the chain with all loaded plugins and their state alive after a connection loss, so a
+// reconnecting client resumes in one round trip instead of rebuilding the chain plugin by plugin.
+void AudioWorker::park(uint32 token) {
+    // bring the audio pipeline down first, nothing may touch the chain while it gets swapped out
+    m_stop = true;
+    signalThreadShouldExit();
+    waitForThreadToExit(-1);
+    m_chain->releaseResources();
+    std::lock_guard<std::mutex> lock(m_parkedMtx);
+    purgeParked();
+    logln("parking session with " << m_chain->getSize() << " plugins");
+    m_parked[token] = {m_chain, Time::currentTimeMillis()};
+    // the shutdown that follows operates on a fresh chain and leaves the parked one alone
+    m_chain = std::make_shared<ProcessorChain>();
+}
+
+bool AudioWorker::tryResume(uint32 token) {
+    std::lock_guard<std::mutex> lock(m_parkedMtx);
+    purgeParked();
+    auto it = m_parked.find(token);
+    if (it == m_parked.end()) {
+        return false;
+    }
+    m_chain = std::move(it->second.chain);
+    m_parked.erase(it);
+    logln("resuming session with " << m_chain->getSize() << " plugins");
+    return true;
+}
+
+void AudioWorker::purgeParked() {
+    auto now = Time::currentTimeMillis();
+    for (auto it = m_parked.begin(); it != m_parked.end();) {
+        if (now - it->second.parkedAt > DEFAULT_SESSION_GRACE_MS) {
+            // plugin teardown has to happen on the message thread
+            auto pChain = it->second.chain;
+            MessageManager::callAsync([pChain] { pChain->clear(); });
+            it = m_parked.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 bool AudioWorker::addPlugin(const String& id) { return m_chain->addPluginProcessor(id); }
 
 void AudioWorker::delPlugin(int idx) {
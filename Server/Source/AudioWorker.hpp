@@ -9,8 +9,12 @@
 #define AudioWorker_hpp
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "Metrics.hpp"
 #include "ProcessorChain.hpp"
+#include "SharedMemory.hpp"
+#include "StreamCapture.hpp"
 #include <thread>
+#include <unordered_map>
 
 namespace e47 {
 
@@ -27,19 +31,27 @@ class AudioWorker : public Thread {
     AudioWorker() : Thread("AudioWorker") { m_chain = std::make_shared<ProcessorChain>(); }
     virtual ~AudioWorker();
 
-    void init(std::unique_ptr<StreamingSocket> s, int channels, double rate, int samplesPerBlock, bool doublePrecission,
-              std::function<void()> fn);
+    void init(std::unique_ptr<StreamingSocket> s, int clientPort, int channels, double rate, int samplesPerBlock,
+              bool doublePrecission, int wireFlags, std::function<void()> fn);
 
     void run() override;
     void shutdown();
     void clear();
 
+    // session resume: a chain parked on connection loss survives for DEFAULT_SESSION_GRACE_MS,
+    // a reconnecting client with the matching handshake token picks it up via tryResume
+    void park(uint32 token);
+    bool tryResume(uint32 token);
+
     bool addPlugin(const String& id);
     void delPlugin(int idx);
     void exchangePlugins(int idxA, int idxB);
     std::shared_ptr<AudioPluginInstance> getProcessor(int idx) const { return m_chain->getProcessor(idx); }
     int getSize() const { return static_cast<int>(m_chain->getSize()); }
     int getLatencySamples() const { return m_chain->getLatencySamples(); }
+    bool supportsDoublePrecision() const { return m_chain->supportsDoublePrecisionProcessing(); }
+    double getAverageProcessTimeMs() const { return m_chain->getAverageProcessTimeMs(); }
+    json getProcTimes() const { return m_chain->getProcTimes(); }
 
     float getParameterValue(int idx, int paramIdx) { return m_chain->getParameterValue(idx, paramIdx); }
 
@@ -48,12 +60,79 @@ class AudioWorker : public Thread {
     void addToRecentsList(const String& id, const String& host);
 
   private:
+    // Single-depth handoff slots for the read -> process -> send pipeline: a reader thread pulls
+    // the next block and a sender thread flushes the previous result while the worker runs DSP on
+    // the current one, so network I/O and processing overlap instead of adding up per block.
+    struct Block {
+        AudioBuffer<float> bufferF;
+        AudioBuffer<double> bufferD;
+        MidiBuffer midi;
+        AudioPlayHead::CurrentPositionInfo posInfo;
+        int channels = 0;
+        int samples = 0;
+        bool isDouble = false;
+        int latencySamples = 0;
+        // stage stamps for the round trip breakdown, echoed back in the response header
+        double clientSentAt = 0.0;
+        double receivedAt = 0.0;
+        double procStartAt = 0.0;
+        double procEndAt = 0.0;
+        std::atomic_bool full{false};
+    };
+
+    class Reader : public Thread {
+      public:
+        Reader(AudioWorker& w) : Thread("AudioWorkerReader"), m_worker(w) {}
+        void run() override;
+
+      private:
+        AudioWorker& m_worker;
+    };
+
+    class Sender : public Thread {
+      public:
+        Sender(AudioWorker& w) : Thread("AudioWorkerSender"), m_worker(w) {}
+        void run() override;
+
+      private:
+        AudioWorker& m_worker;
+    };
+
+    friend Reader;
+    friend Sender;
+
+    Block m_inBlock, m_outBlock;
+    std::atomic_bool m_stop{false};
+
+    bool waitBlockFull(Block& block);
+    bool waitBlockEmpty(Block& block);
+
     std::unique_ptr<StreamingSocket> m_socket;
     int m_channels;
     double m_rate;
     int m_samplesPerBlock;
     bool m_doublePrecission;
+    int m_wireFlags = 0;
+    // same-host zero-copy transport, opened when the client negotiated AUDIO_WIRE_SHM
+    SharedMemoryRing m_shmUp, m_shmDown;
+    // datagram audio transport (AUDIO_WIRE_UDP), the TCP audio socket stays for liveness
+    std::unique_ptr<DatagramSocket> m_udp;
+    String m_clientHost;
+    int m_clientPort = 0;
     std::shared_ptr<ProcessorChain> m_chain;
+    std::shared_ptr<Metrics::Channel> m_metrics;
+    // request stream recorder, active when the server config sets CaptureStream (see Replay)
+    std::unique_ptr<StreamCapture> m_capture;
+
+    // chains of disconnected clients waiting for a resume, keyed by the handshake session token
+    struct ParkedChain {
+        std::shared_ptr<ProcessorChain> chain;
+        int64 parkedAt;
+    };
+    static std::unordered_map<uint32, ParkedChain> m_parked;
+    static std::mutex m_parkedMtx;
+    static void purgeParked();  // caller holds m_parkedMtx
+
     static HashMap<String, RecentsListType> m_recents;
     static std::mutex m_recentsMtx;
     std::function<void()> m_onTerminate;
@@ -10,6 +10,10 @@
 
 static constexpr int DEFAULT_CLIENT_PORT = 55055;
 static constexpr int DEFAULT_SERVER_PORT = 55056;
+// UDP port the servers answer discovery broadcasts on, one socket per host (port sharing)
+static constexpr int DEFAULT_DISCOVERY_PORT = 55054;
+// TCP port serving the metrics dump as json over HTTP, offset by the server ID like the main port
+static constexpr int DEFAULT_METRICS_PORT = 55060;
 
 static const String SERVER_CONFIG_FILE = "~/.audiogridderserver";
 static const String PLUGIN_CONFIG_FILE = "~/.audiogridder";
@@ -17,6 +21,9 @@ static const String KNOWN_PLUGINS_FILE = "~/.audiogridderserver.cache";
 static const String DEAD_MANS_FILE = "~/.audiogridderserver.crash";
 
 static constexpr int DEFAULT_NUM_OF_BUFFERS = 8;
+// how long the server keeps the chain of a disconnected client alive for a session resume
+static constexpr int DEFAULT_SESSION_GRACE_MS = 30000;
+static constexpr int DEFAULT_NUM_OF_BUFFERS_OFFLINE = 32;  // pipelining window for offline renders
 static constexpr int DEFAULT_NUM_RECENTS = 10;
 
 static constexpr uint32 DEFAULT_BG_COLOR = 0xff222222;
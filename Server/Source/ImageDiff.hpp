@@ -8,48 +8,149 @@
 #ifndef ImageDiff_hpp
 #define ImageDiff_hpp
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <vector>
+
 namespace e47 {
 
 namespace ImageDiff {
 
+// Edge length of the grid used by getDirtyTiles, the screen channel sends changed tiles only.
+static constexpr int TILE_SIZE = 64;
+
+inline int getNumTilesX(int width) { return (width + TILE_SIZE - 1) / TILE_SIZE; }
+inline int getNumTilesY(int height) { return (height + TILE_SIZE - 1) / TILE_SIZE; }
+
 bool operator==(const PixelARGB& lhs, const PixelARGB& rhs) { return lhs.getNativeARGB() == rhs.getNativeARGB(); }
 
 bool operator!=(const PixelARGB& lhs, const PixelARGB& rhs) { return !(lhs == rhs); }
 
-using PerPixelFn = std::function<void(const PixelARGB& px)>;
+inline float getBrightness(const PixelARGB& px) {
+    auto col = Colour::fromRGBA(px.getRed(), px.getGreen(), px.getBlue(), px.getAlpha());
+    return col.getFloatRed() / 3 + col.getFloatGreen() / 3 + col.getFloatBlue() / 3;
+}
 
+// Calculates the delta image and optionally accumulates the brightness of the current image in the
+// same pass. The brightness used to be a per pixel std::function callback, but the indirect call
+// per pixel kept the loop from being vectorized, so it is fused into the kernel now. With SSE2 we
+// compare four ARGB pixels per iteration and sum the R/G/B bytes in integer lanes, the float
+// division happens once at the end.
 uint64_t getDelta(const uint8_t* imgFrom, const uint8_t* imgTo, uint8_t* imgDelta, int width, int height,
-                  PerPixelFn fn = nullptr) {
+                  float* brightness = nullptr) {
     uint64_t count = 0;
+    uint64_t rgbSum = 0;
     auto* pxFrom = reinterpret_cast<const PixelARGB*>(imgFrom);
     auto* pxTo = reinterpret_cast<const PixelARGB*>(imgTo);
     auto* pxDelta = reinterpret_cast<PixelARGB*>(imgDelta);
+    std::size_t numPx = (std::size_t)width * height;
+    std::size_t p = 0;
+#if defined(__SSE2__)
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);  // B,G,R,A byte order in memory
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rgbAcc = _mm_setzero_si128();
+    for (; p + 4 <= numPx; p += 4) {
+        __m128i vFrom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxFrom + p));
+        __m128i vTo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxTo + p));
+        __m128i eq = _mm_cmpeq_epi32(vFrom, vTo);
+        // changed pixels become the new pixel with alpha forced to 255, unchanged pixels become 0
+        __m128i delta = _mm_andnot_si128(eq, _mm_or_si128(vTo, alphaMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pxDelta + p), delta);
+        count += 4 - (unsigned)__builtin_popcount((unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)));
+        // sum of the R/G/B bytes of all four pixels, accumulated in two 64 bit lanes
+        rgbAcc = _mm_add_epi64(rgbAcc, _mm_sad_epu8(_mm_andnot_si128(alphaMask, vTo), zero));
+    }
+    rgbSum = (uint64_t)_mm_cvtsi128_si64(rgbAcc) + (uint64_t)_mm_cvtsi128_si64(_mm_srli_si128(rgbAcc, 8));
+#endif
+    for (; p < numPx; p++) {
+        if (pxFrom[p] != pxTo[p]) {
+            count++;
+            pxDelta[p].set(pxTo[p]);
+            pxDelta[p].setAlpha(255);
+        } else {
+            pxDelta[p] = {0, 0, 0, 0};
+        }
+        rgbSum += pxTo[p].getRed() + pxTo[p].getGreen() + pxTo[p].getBlue();
+    }
+    if (nullptr != brightness) {
+        *brightness = rgbSum / (3 * 255.0f);
+    }
+    return count;
+}
+
+uint64_t getDelta(const Image& imgFrom, const Image& imgTo, const Image& imgDelta, float* brightness = nullptr) {
+    if (imgFrom.getBounds() == imgTo.getBounds() && imgDelta.getBounds() == imgTo.getBounds()) {
+        int width = imgTo.getWidth();
+        int height = imgTo.getHeight();
+        const Image::BitmapData bdFrom(imgFrom, 0, 0, width, height);
+        const Image::BitmapData bdTo(imgTo, 0, 0, width, height);
+        Image::BitmapData bdDelta(imgDelta, 0, 0, width, height);
+        return getDelta(bdFrom.data, bdTo.data, bdDelta.data, width, height, brightness);
+    }
+    return 0;
+}
+
+// Marks the tiles of the TILE_SIZE grid that contain changed pixels, row-major. Same kernel
+// structure as getDelta, but instead of producing a delta image it flags the tiles the changes
+// fall into, so the sender only has to encode those. A four pixel group never straddles a tile
+// boundary since TILE_SIZE is a multiple of four.
+uint64_t getDirtyTiles(const uint8_t* imgFrom, const uint8_t* imgTo, int width, int height,
+                       std::vector<bool>& dirtyTiles, float* brightness = nullptr) {
+    uint64_t count = 0;
+    uint64_t rgbSum = 0;
+    auto* pxFrom = reinterpret_cast<const PixelARGB*>(imgFrom);
+    auto* pxTo = reinterpret_cast<const PixelARGB*>(imgTo);
+    int tilesX = getNumTilesX(width);
+    dirtyTiles.assign((std::size_t)tilesX * getNumTilesY(height), false);
+#if defined(__SSE2__)
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rgbAcc = _mm_setzero_si128();
+#endif
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            std::size_t p = y * width + x;
+        std::size_t rowPx = (std::size_t)y * width;
+        std::size_t rowTile = (std::size_t)(y / TILE_SIZE) * tilesX;
+        int x = 0;
+#if defined(__SSE2__)
+        for (; x + 4 <= width; x += 4) {
+            __m128i vFrom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxFrom + rowPx + x));
+            __m128i vTo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxTo + rowPx + x));
+            int eq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(vFrom, vTo)));
+            if (eq != 0x0f) {
+                count += 4 - (unsigned)__builtin_popcount((unsigned)eq);
+                dirtyTiles[rowTile + (std::size_t)(x / TILE_SIZE)] = true;
+            }
+            rgbAcc = _mm_add_epi64(rgbAcc, _mm_sad_epu8(_mm_andnot_si128(alphaMask, vTo), zero));
+        }
+#endif
+        for (; x < width; x++) {
+            std::size_t p = rowPx + x;
             if (pxFrom[p] != pxTo[p]) {
                 count++;
-                pxDelta[p].set(pxTo[p]);
-                pxDelta[p].setAlpha(255);
-            } else {
-                pxDelta[p] = {0, 0, 0, 0};
-            }
-            if (fn) {
-                fn(pxTo[p]);
+                dirtyTiles[rowTile + (std::size_t)(x / TILE_SIZE)] = true;
             }
+            rgbSum += pxTo[p].getRed() + pxTo[p].getGreen() + pxTo[p].getBlue();
         }
     }
+#if defined(__SSE2__)
+    rgbSum += (uint64_t)_mm_cvtsi128_si64(rgbAcc) + (uint64_t)_mm_cvtsi128_si64(_mm_srli_si128(rgbAcc, 8));
+#endif
+    if (nullptr != brightness) {
+        *brightness = rgbSum / (3 * 255.0f);
+    }
     return count;
 }
 
-uint64_t getDelta(const Image& imgFrom, const Image& imgTo, const Image& imgDelta, PerPixelFn fn = nullptr) {
-    if (imgFrom.getBounds() == imgTo.getBounds() && imgDelta.getBounds() == imgTo.getBounds()) {
+uint64_t getDirtyTiles(const Image& imgFrom, const Image& imgTo, std::vector<bool>& dirtyTiles,
+                       float* brightness = nullptr) {
+    if (imgFrom.getBounds() == imgTo.getBounds()) {
         int width = imgTo.getWidth();
         int height = imgTo.getHeight();
         const Image::BitmapData bdFrom(imgFrom, 0, 0, width, height);
         const Image::BitmapData bdTo(imgTo, 0, 0, width, height);
-        Image::BitmapData bdDelta(imgDelta, 0, 0, width, height);
-        return getDelta(bdFrom.data, bdTo.data, bdDelta.data, width, height, fn);
+        return getDirtyTiles(bdFrom.data, bdTo.data, width, height, dirtyTiles, brightness);
     }
     return 0;
 }
@@ -58,13 +159,24 @@ uint64_t applyDelta(uint8_t* imgDst, const uint8_t* imgDelta, int width, int hei
     uint64_t count = 0;
     auto* pxDst = reinterpret_cast<PixelARGB*>(imgDst);
     auto* pxDelta = reinterpret_cast<const PixelARGB*>(imgDelta);
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            std::size_t p = y * width + x;
-            if (pxDelta[p].getAlpha() == 255) {
-                pxDst[p].set(pxDelta[p]);
-                count++;
-            }
+    std::size_t numPx = (std::size_t)width * height;
+    std::size_t p = 0;
+#if defined(__SSE2__)
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    for (; p + 4 <= numPx; p += 4) {
+        __m128i vDelta = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxDelta + p));
+        __m128i vDst = _mm_loadu_si128(reinterpret_cast<__m128i*>(pxDst + p));
+        // lanes with alpha == 255 carry a changed pixel
+        __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(vDelta, alphaMask), alphaMask);
+        __m128i blended = _mm_or_si128(_mm_and_si128(mask, vDelta), _mm_andnot_si128(mask, vDst));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pxDst + p), blended);
+        count += (unsigned)__builtin_popcount((unsigned)_mm_movemask_ps(_mm_castsi128_ps(mask)));
+    }
+#endif
+    for (; p < numPx; p++) {
+        if (pxDelta[p].getAlpha() == 255) {
+            pxDst[p].set(pxDelta[p]);
+            count++;
         }
     }
     return count;
@@ -81,21 +193,25 @@ uint64_t applyDelta(Image& imgDst, const Image& imgDelta) {
     return 0;
 }
 
-inline float getBrightness(const PixelARGB& px) {
-    auto col = Colour::fromRGBA(px.getRed(), px.getGreen(), px.getBlue(), px.getAlpha());
-    return col.getFloatRed() / 3 + col.getFloatGreen() / 3 + col.getFloatBlue() / 3;
-}
-
 float getBrightness(const uint8_t* img, int width, int height) {
     auto* px = reinterpret_cast<const PixelARGB*>(img);
-    float brightness = 0;
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            std::size_t p = y * width + x;
-            brightness += getBrightness(px[p]);
-        }
+    uint64_t rgbSum = 0;
+    std::size_t numPx = (std::size_t)width * height;
+    std::size_t p = 0;
+#if defined(__SSE2__)
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rgbAcc = _mm_setzero_si128();
+    for (; p + 4 <= numPx; p += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + p));
+        rgbAcc = _mm_add_epi64(rgbAcc, _mm_sad_epu8(_mm_andnot_si128(alphaMask, v), zero));
+    }
+    rgbSum = (uint64_t)_mm_cvtsi128_si64(rgbAcc) + (uint64_t)_mm_cvtsi128_si64(_mm_srli_si128(rgbAcc, 8));
+#endif
+    for (; p < numPx; p++) {
+        rgbSum += px[p].getRed() + px[p].getGreen() + px[p].getBlue();
     }
-    return brightness;
+    return rgbSum / (3 * 255.0f);
 }
 
 float getBrightness(const Image& img) {
@@ -9,9 +9,13 @@
 #define Message_hpp
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <type_traits>
+#include <vector>
 
 #include "KeyAndMouse.hpp"
+#include "SharedMemory.hpp"
+#include "StreamCapture.hpp"
 #include "json.hpp"
 
 namespace e47 {
@@ -54,6 +58,42 @@ static bool send(StreamingSocket* socket, const char* data, int size, MessageHel
     }
 }
 
+// Gathered write: flushes a whole iovec array with as few writev syscalls as possible instead of
+// one send() per fragment.
+static bool sendv(StreamingSocket* socket, struct iovec* iov, int count, MessageHelper::Error* e = nullptr) {
+    if (nullptr == socket || !socket->isConnected()) {
+        return false;
+    }
+    int idx = 0;
+    while (idx < count) {
+        int ret = socket->waitUntilReady(false, 100);
+        if (ret < 0) {
+            MessageHelper::seterr(e, MessageHelper::E_SYSCALL);
+            return false;  // error
+        } else if (ret > 0) {
+            int num = count - idx > IOV_MAX ? IOV_MAX : count - idx;
+            ssize_t len = ::writev(socket->getRawSocketHandle(), iov + idx, num);
+            if (len < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    continue;
+                }
+                MessageHelper::seterr(e, MessageHelper::E_SYSCALL);
+                return false;
+            }
+            // consume fully written fragments, adjust a partially written one
+            while (idx < count && len >= static_cast<ssize_t>(iov[idx].iov_len)) {
+                len -= iov[idx].iov_len;
+                idx++;
+            }
+            if (idx < count && len > 0) {
+                iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + len;
+                iov[idx].iov_len -= len;
+            }
+        }
+    }
+    return true;
+}
+
 static bool read(StreamingSocket* socket, void* data, int size, int timeoutMilliseconds = 0,
                  MessageHelper::Error* e = nullptr) {
     MessageHelper::seterr(e, MessageHelper::E_NONE);
@@ -96,6 +136,24 @@ static bool read(StreamingSocket* socket, void* data, int size, int timeoutMilli
 /*
  * Client/Server handshake
  */
+static constexpr int AUDIO_WIRE_INT16 = 1;  // transmit audio as dithered int16 on the wire
+static constexpr int AUDIO_WIRE_SHM = 2;    // same-host transport through shared memory rings
+static constexpr int AUDIO_WIRE_UDP = 4;    // datagram audio transport, one block per packet
+static constexpr int WIRE_MUX = 8;          // screen stream multiplexed onto the command connection
+
+// An audio block has to fit into a single datagram in UDP mode.
+static constexpr int UDP_MAX_PACKET = 65000;
+// The server announces its datagram port by sending this magic to the client's audio port.
+static constexpr uint32 UDP_HELLO = 0xffffffff;
+
+// Clients broadcast this magic to DEFAULT_DISCOVERY_PORT, servers answer with a JSON datagram
+// carrying their id, port, name and load metric.
+static constexpr uint32 DISCOVERY_QUERY = 0x41474451;  // "AGDQ"
+
+// A handshake with this version is a load probe: the server answers with a ServerLoad message
+// and closes, no audio/screen connections get established.
+static constexpr int HANDSHAKE_PROBE = -1;
+
 struct Handshake {
     int version;
     int clientPort;
@@ -103,6 +161,10 @@ struct Handshake {
     double rate;
     int samplesPerBlock;
     bool doublePrecission;
+    int flags;                // AUDIO_WIRE_*
+    uint32 pluginListHash;    // hash of the client's cached plugin list, version 3+
+    uint32 sessionToken;      // random per plugin instance, a reconnect with a known token
+                              // resumes the parked chain, version 6+
 };
 
 /*
@@ -115,11 +177,21 @@ class AudioMessage {
         int samples;
         bool isDouble;
         int numMidiEvents;
+        int midiBytes;
+        double sentAt;  // client clock (ms), stamped right before the block hits the wire
     };
 
     struct ResponseHeader {
         int latencySamples;
         int numMidiEvents;
+        int midiBytes;
+        // Round trip breakdown: the client send stamp echoed back plus the server side stage
+        // stamps on the server clock. The client estimates the clock offset NTP style from the
+        // echoed stamp and its own receive time, see AudioStreamer::readReal.
+        double clientSentAt;
+        double receivedAt;
+        double procStartAt;
+        double procEndAt;
     };
 
     struct MidiHeader {
@@ -133,6 +205,34 @@ class AudioMessage {
 
     int getLatencySamples() const { return m_resHeader.latencySamples; }
 
+    double getClientSentAt() const { return m_reqHeader.sentAt; }
+    double getRespClientSentAt() const { return m_resHeader.clientSentAt; }
+    double getRespReceivedAt() const { return m_resHeader.receivedAt; }
+    double getRespProcStartAt() const { return m_resHeader.procStartAt; }
+    double getRespProcEndAt() const { return m_resHeader.procEndAt; }
+    void setTimestamps(double clientSentAt, double receivedAt, double procStartAt, double procEndAt) {
+        m_resHeader.clientSentAt = clientSentAt;
+        m_resHeader.receivedAt = receivedAt;
+        m_resHeader.procStartAt = procStartAt;
+        m_resHeader.procEndAt = procEndAt;
+    }
+
+    // Wire format negotiated via Handshake::flags. Conversion happens on the streamer/worker
+    // threads, never on the DAW render thread.
+    void setWireFlags(int flags) { m_wireFlags = flags; }
+
+    // Optional capture sink: every request frame passing through this message gets appended to
+    // the capture for offline replay (see Replay), works on both ends of the connection.
+    void setCapture(StreamCapture* capture) { m_capture = capture; }
+
+    // The response frame mirrors the request dimensions. A sender running detached from the
+    // message instance that read the request sets them explicitly.
+    void setFrame(int channels, int samples, bool isDouble) {
+        m_reqHeader.channels = channels;
+        m_reqHeader.samples = samples;
+        m_reqHeader.isDouble = isDouble;
+    }
+
     template <typename T>
     bool sendToServer(StreamingSocket* socket, AudioBuffer<T>& buffer, MidiBuffer& midi,
                       AudioPlayHead::CurrentPositionInfo& posInfo) {
@@ -140,28 +240,18 @@ class AudioMessage {
         m_reqHeader.samples = buffer.getNumSamples();
         m_reqHeader.isDouble = std::is_same<T, double>::value;
         m_reqHeader.numMidiEvents = midi.getNumEvents();
+        m_reqHeader.midiBytes = static_cast<int>(serializeMidi(midi));
+        m_reqHeader.sentAt = Time::getMillisecondCounterHiRes();
+        if (nullptr != m_capture) {
+            captureRequest(buffer, posInfo);
+        }
         if (socket->isConnected()) {
-            if (!send(socket, reinterpret_cast<const char*>(&m_reqHeader), sizeof(m_reqHeader))) {
-                return false;
-            }
-            for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
-                if (!send(socket, reinterpret_cast<const char*>(buffer.getReadPointer(chan)),
-                          m_reqHeader.samples * sizeof(T))) {
-                    return false;
-                }
-            }
-            const uint8* midiData;
-            MidiHeader midiHdr;
-            MidiBuffer::Iterator midiIt(midi);
-            while (midiIt.getNextEvent(midiData, midiHdr.size, midiHdr.sampleNumber)) {
-                if (!send(socket, reinterpret_cast<const char*>(&midiHdr), sizeof(midiHdr))) {
-                    return false;
-                }
-                if (!send(socket, reinterpret_cast<const char*>(midiData), midiHdr.size)) {
-                    return false;
-                }
-            }
-            if (!send(socket, reinterpret_cast<const char*>(&posInfo), sizeof(posInfo))) {
+            m_iov.clear();
+            addToVec(&m_reqHeader, sizeof(m_reqHeader));
+            addChannelsToVec(buffer, m_reqHeader.channels, m_reqHeader.samples);
+            addToVec(m_midiData.data(), m_reqHeader.midiBytes);
+            addToVec(&posInfo, sizeof(posInfo));
+            if (!sendv(socket, m_iov.data(), static_cast<int>(m_iov.size()))) {
                 return false;
             }
         }
@@ -172,27 +262,15 @@ class AudioMessage {
     bool sendToClient(StreamingSocket* socket, AudioBuffer<T>& buffer, MidiBuffer& midi, int latencySamples) {
         m_resHeader.latencySamples = latencySamples;
         m_resHeader.numMidiEvents = midi.getNumEvents();
+        m_resHeader.midiBytes = static_cast<int>(serializeMidi(midi));
         if (socket->isConnected()) {
-            if (!send(socket, reinterpret_cast<const char*>(&m_resHeader), sizeof(m_resHeader))) {
+            m_iov.clear();
+            addToVec(&m_resHeader, sizeof(m_resHeader));
+            addChannelsToVec(buffer, m_reqHeader.channels, m_reqHeader.samples);
+            addToVec(m_midiData.data(), m_resHeader.midiBytes);
+            if (!sendv(socket, m_iov.data(), static_cast<int>(m_iov.size()))) {
                 return false;
             }
-            for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
-                if (!send(socket, reinterpret_cast<const char*>(buffer.getReadPointer(chan)),
-                          m_reqHeader.samples * sizeof(T))) {
-                    return false;
-                }
-            }
-            const uint8* midiData;
-            MidiHeader midiHdr;
-            MidiBuffer::Iterator midiIt(midi);
-            while (midiIt.getNextEvent(midiData, midiHdr.size, midiHdr.sampleNumber)) {
-                if (!send(socket, reinterpret_cast<const char*>(&midiHdr), sizeof(midiHdr))) {
-                    return false;
-                }
-                if (!send(socket, reinterpret_cast<const char*>(midiData), midiHdr.size)) {
-                    return false;
-                }
-            }
         }
         return true;
     }
@@ -203,25 +281,11 @@ class AudioMessage {
             if (!read(socket, &m_resHeader, sizeof(m_resHeader), 1000, e)) {
                 return false;
             }
-            for (int chan = 0; chan < buffer.getNumChannels(); ++chan) {
-                if (!read(socket, buffer.getWritePointer(chan), buffer.getNumSamples() * sizeof(T), 1000, e)) {
-                    return false;
-                }
+            if (!readChannels(socket, buffer, buffer.getNumChannels(), buffer.getNumSamples(), 1000, e)) {
+                return false;
             }
-            midi.clear();
-            std::vector<char> midiData;
-            MidiHeader midiHdr;
-            for (int i = 0; i < m_resHeader.numMidiEvents; i++) {
-                if (!read(socket, &midiHdr, sizeof(midiHdr), 1000, e)) {
-                    return false;
-                }
-                if (midiData.size() < midiHdr.size) {
-                    midiData.resize(midiHdr.size);
-                }
-                if (!read(socket, midiData.data(), midiHdr.size, 1000, e)) {
-                    return false;
-                }
-                midi.addEvent(midiData.data(), midiHdr.size, midiHdr.sampleNumber);
+            if (!readMidi(socket, midi, m_resHeader.numMidiEvents, m_resHeader.midiBytes, 1000, e)) {
+                return false;
             }
         } else {
             *e = MessageHelper::E_STATE;
@@ -237,7 +301,6 @@ class AudioMessage {
             if (!read(socket, &m_reqHeader, sizeof(m_reqHeader))) {
                 return false;
             }
-            int size;
             // Arbitarry additional channels to support plugins that have more than one input bus. Plugins that don't
             // need it, should ignore the channels.
             int channels = m_reqHeader.channels + extraChannels;
@@ -247,34 +310,21 @@ class AudioMessage {
                 for (int chan = m_reqHeader.channels; chan < channels; ++chan) {
                     bufferD.clear(chan, 0, m_reqHeader.samples);
                 }
-                size = m_reqHeader.samples * sizeof(double);
+                if (!readChannels(socket, bufferD, m_reqHeader.channels, m_reqHeader.samples)) {
+                    return false;
+                }
             } else {
                 bufferF.setSize(channels, m_reqHeader.samples);
                 // no data for extra channels
                 for (int chan = m_reqHeader.channels; chan < channels; ++chan) {
                     bufferF.clear(chan, 0, m_reqHeader.samples);
                 }
-                size = m_reqHeader.samples * sizeof(float);
-            }
-            for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
-                char* data = m_reqHeader.isDouble ? reinterpret_cast<char*>(bufferD.getWritePointer(chan))
-                                                  : reinterpret_cast<char*>(bufferF.getWritePointer(chan));
-                if (!read(socket, data, size)) {
+                if (!readChannels(socket, bufferF, m_reqHeader.channels, m_reqHeader.samples)) {
                     return false;
                 }
             }
-            midi.clear();
-            for (int i = 0; i < m_reqHeader.numMidiEvents; i++) {
-                std::vector<char> midiData;
-                MidiHeader midiHdr;
-                if (!read(socket, &midiHdr, sizeof(midiHdr))) {
-                    return false;
-                }
-                midiData.resize(midiHdr.size);
-                if (!read(socket, midiData.data(), midiHdr.size)) {
-                    return false;
-                }
-                midi.addEvent(midiData.data(), midiHdr.size, midiHdr.sampleNumber);
+            if (!readMidi(socket, midi, m_reqHeader.numMidiEvents, m_reqHeader.midiBytes)) {
+                return false;
             }
             if (!read(socket, &posInfo, sizeof(posInfo))) {
                 return false;
@@ -282,12 +332,498 @@ class AudioMessage {
         } else {
             return false;
         }
+        if (nullptr != m_capture) {
+            if (m_reqHeader.isDouble) {
+                captureRequest(bufferD, posInfo);
+            } else {
+                captureRequest(bufferF, posInfo);
+            }
+        }
         return true;
     }
 
+    /*
+     * Shared memory variants for same-host sessions. A slot carries the same byte layout as the
+     * socket stream, written and parsed in place with a single copy per block.
+     */
+    template <typename T>
+    bool sendToServer(SharedMemoryRing& ring, AudioBuffer<T>& buffer, MidiBuffer& midi,
+                      AudioPlayHead::CurrentPositionInfo& posInfo) {
+        m_reqHeader.channels = buffer.getNumChannels();
+        m_reqHeader.samples = buffer.getNumSamples();
+        m_reqHeader.isDouble = std::is_same<T, double>::value;
+        m_reqHeader.numMidiEvents = midi.getNumEvents();
+        m_reqHeader.midiBytes = static_cast<int>(serializeMidi(midi));
+        m_reqHeader.sentAt = Time::getMillisecondCounterHiRes();
+        if (nullptr != m_capture) {
+            captureRequest(buffer, posInfo);
+        }
+        size_t needed = sizeof(m_reqHeader) + m_reqHeader.channels * m_reqHeader.samples * sizeof(T) +
+                        m_reqHeader.midiBytes + sizeof(posInfo);
+        char* dst = waitWriteSlot(ring, needed);
+        if (nullptr == dst) {
+            return false;
+        }
+        size_t off = 0;
+        shmWrite(dst, off, &m_reqHeader, sizeof(m_reqHeader));
+        for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
+            shmWrite(dst, off, buffer.getReadPointer(chan), m_reqHeader.samples * sizeof(T));
+        }
+        shmWrite(dst, off, m_midiData.data(), m_reqHeader.midiBytes);
+        shmWrite(dst, off, &posInfo, sizeof(posInfo));
+        ring.commitWrite(static_cast<uint32_t>(off));
+        return true;
+    }
+
+    template <typename T>
+    bool readFromServer(SharedMemoryRing& ring, AudioBuffer<T>& buffer, MidiBuffer& midi, MessageHelper::Error* e) {
+        uint32_t size;
+        const char* src = ring.beginRead(size, 1000);
+        if (nullptr == src) {
+            MessageHelper::seterr(e, MessageHelper::E_TIMEOUT);
+            return false;
+        }
+        bool success = parseResponse(src, size, buffer, midi, e);
+        ring.commitRead();
+        return success;
+    }
+
+    template <typename T>
+    bool sendToClient(SharedMemoryRing& ring, AudioBuffer<T>& buffer, MidiBuffer& midi, int latencySamples) {
+        m_resHeader.latencySamples = latencySamples;
+        m_resHeader.numMidiEvents = midi.getNumEvents();
+        m_resHeader.midiBytes = static_cast<int>(serializeMidi(midi));
+        size_t needed =
+            sizeof(m_resHeader) + m_reqHeader.channels * m_reqHeader.samples * sizeof(T) + m_resHeader.midiBytes;
+        char* dst = waitWriteSlot(ring, needed);
+        if (nullptr == dst) {
+            return false;
+        }
+        size_t off = 0;
+        shmWrite(dst, off, &m_resHeader, sizeof(m_resHeader));
+        for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
+            shmWrite(dst, off, buffer.getReadPointer(chan), m_reqHeader.samples * sizeof(T));
+        }
+        shmWrite(dst, off, m_midiData.data(), m_resHeader.midiBytes);
+        ring.commitWrite(static_cast<uint32_t>(off));
+        return true;
+    }
+
+    bool readFromClient(SharedMemoryRing& ring, AudioBuffer<float>& bufferF, AudioBuffer<double>& bufferD,
+                        MidiBuffer& midi, AudioPlayHead::CurrentPositionInfo& posInfo, int extraChannels = 1) {
+        uint32_t size;
+        const char* src = ring.beginRead(size, 1000);
+        if (nullptr == src) {
+            return false;
+        }
+        bool success = parseRequest(src, size, bufferF, bufferD, midi, posInfo, extraChannels);
+        if (success && nullptr != m_capture) {
+            captureRaw(src, size);  // the slot carries the capture layout already
+        }
+        ring.commitRead();
+        return success;
+    }
+
+    /*
+     * Datagram variants for the UDP LAN mode. One block travels as one sequence-numbered packet,
+     * the receiver reorders within a short window and repeats the last block on a genuine loss
+     * instead of stalling the stream.
+     */
+    void setUdpPeer(const String& host, int port) {
+        m_udpPeerHost = host;
+        m_udpPeerPort = port;
+    }
+
+    template <typename T>
+    bool sendToServer(DatagramSocket& socket, AudioBuffer<T>& buffer, MidiBuffer& midi,
+                      AudioPlayHead::CurrentPositionInfo& posInfo) {
+        m_reqHeader.channels = buffer.getNumChannels();
+        m_reqHeader.samples = buffer.getNumSamples();
+        m_reqHeader.isDouble = std::is_same<T, double>::value;
+        m_reqHeader.numMidiEvents = midi.getNumEvents();
+        m_reqHeader.midiBytes = static_cast<int>(serializeMidi(midi));
+        m_reqHeader.sentAt = Time::getMillisecondCounterHiRes();
+        if (nullptr != m_capture) {
+            captureRequest(buffer, posInfo);
+        }
+        size_t needed = sizeof(uint32) + sizeof(m_reqHeader) + m_reqHeader.channels * m_reqHeader.samples * sizeof(T) +
+                        m_reqHeader.midiBytes + sizeof(posInfo);
+        if (needed > UDP_MAX_PACKET) {
+            return false;  // guarded against at init time, block does not fit into a datagram
+        }
+        if (m_packet.size() < needed) {
+            m_packet.resize(needed);
+        }
+        size_t off = 0;
+        shmWrite(m_packet.data(), off, &m_udpSendSeq, sizeof(m_udpSendSeq));
+        m_udpSendSeq++;
+        shmWrite(m_packet.data(), off, &m_reqHeader, sizeof(m_reqHeader));
+        for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
+            shmWrite(m_packet.data(), off, buffer.getReadPointer(chan), m_reqHeader.samples * sizeof(T));
+        }
+        shmWrite(m_packet.data(), off, m_midiData.data(), m_reqHeader.midiBytes);
+        shmWrite(m_packet.data(), off, &posInfo, sizeof(posInfo));
+        return socket.write(m_udpPeerHost, m_udpPeerPort, m_packet.data(), static_cast<int>(off)) ==
+               static_cast<int>(off);
+    }
+
+    template <typename T>
+    bool readFromServer(DatagramSocket& socket, AudioBuffer<T>& buffer, MidiBuffer& midi, MessageHelper::Error* e) {
+        const char* src;
+        uint32_t size;
+        if (udpReceive(socket, 50, src, size)) {
+            m_udpConceals = 0;
+            // keep a copy for concealment
+            m_lastBlock.assign(src, src + size);
+            return parseResponse(src, size, buffer, midi, e);
+        }
+        // Conceal a lost packet by repeating the last block, but give up after a second of
+        // silence, so a dead connection still surfaces as an error.
+        if (!m_lastBlock.empty() && ++m_udpConceals < 20) {
+            return parseResponse(m_lastBlock.data(), static_cast<uint32_t>(m_lastBlock.size()), buffer, midi, e);
+        }
+        MessageHelper::seterr(e, MessageHelper::E_TIMEOUT);
+        return false;
+    }
+
+    template <typename T>
+    bool sendToClient(DatagramSocket& socket, AudioBuffer<T>& buffer, MidiBuffer& midi, int latencySamples) {
+        m_resHeader.latencySamples = latencySamples;
+        m_resHeader.numMidiEvents = midi.getNumEvents();
+        m_resHeader.midiBytes = static_cast<int>(serializeMidi(midi));
+        size_t needed = sizeof(uint32) + sizeof(m_resHeader) + m_reqHeader.channels * m_reqHeader.samples * sizeof(T) +
+                        m_resHeader.midiBytes;
+        if (needed > UDP_MAX_PACKET) {
+            return false;
+        }
+        if (m_packet.size() < needed) {
+            m_packet.resize(needed);
+        }
+        size_t off = 0;
+        shmWrite(m_packet.data(), off, &m_udpSendSeq, sizeof(m_udpSendSeq));
+        m_udpSendSeq++;
+        shmWrite(m_packet.data(), off, &m_resHeader, sizeof(m_resHeader));
+        for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
+            shmWrite(m_packet.data(), off, buffer.getReadPointer(chan), m_reqHeader.samples * sizeof(T));
+        }
+        shmWrite(m_packet.data(), off, m_midiData.data(), m_resHeader.midiBytes);
+        return socket.write(m_udpPeerHost, m_udpPeerPort, m_packet.data(), static_cast<int>(off)) ==
+               static_cast<int>(off);
+    }
+
+    bool readFromClient(DatagramSocket& socket, AudioBuffer<float>& bufferF, AudioBuffer<double>& bufferD,
+                        MidiBuffer& midi, AudioPlayHead::CurrentPositionInfo& posInfo, int extraChannels = 1) {
+        const char* src;
+        uint32_t size;
+        if (!udpReceive(socket, 1000, src, size)) {
+            return false;  // timeout, the caller checks the command socket and retries
+        }
+        bool success = parseRequest(src, size, bufferF, bufferD, midi, posInfo, extraChannels);
+        if (success && nullptr != m_capture) {
+            captureRaw(src, size);  // the sequence number is stripped, this is the capture layout
+        }
+        return success;
+    }
+
   private:
     RequestHeader m_reqHeader;
     ResponseHeader m_resHeader;
+    int m_wireFlags = 0;
+    // scratch space for the gathered write path, MIDI batching and wire conversion, reused across blocks
+    std::vector<struct iovec> m_iov;
+    std::vector<char> m_midiData;
+    std::vector<int16_t> m_wireData;
+    Random m_dither;
+    // datagram transport state
+    String m_udpPeerHost;
+    int m_udpPeerPort = 0;
+    uint32_t m_udpSendSeq = 0;
+    uint32_t m_udpRecvSeq = 0;
+    int m_udpConceals = 0;
+    std::vector<char> m_packet;     // receive/assembly buffer
+    std::vector<char> m_udpHeld;    // out-of-order packet parked in the reordering window
+    uint32_t m_udpHeldSeq = 0;
+    bool m_udpHasHeld = false;
+    std::vector<char> m_lastBlock;  // last good block for loss concealment
+    StreamCapture* m_capture = nullptr;
+
+    // Appends the current request frame to the capture in the plain contiguous layout
+    // (RequestHeader, samples, MIDI, posInfo), independent of the negotiated wire format.
+    template <typename T>
+    void captureRequest(AudioBuffer<T>& buffer, AudioPlayHead::CurrentPositionInfo& posInfo) {
+        size_t needed = sizeof(m_reqHeader) + m_reqHeader.channels * m_reqHeader.samples * sizeof(T) +
+                        m_reqHeader.midiBytes + sizeof(posInfo);
+        char* dst = m_capture->beginFrame(needed);
+        if (nullptr == dst) {
+            return;  // growing the capture file failed, skip the frame
+        }
+        size_t off = 0;
+        shmWrite(dst, off, &m_reqHeader, sizeof(m_reqHeader));
+        for (int chan = 0; chan < m_reqHeader.channels; ++chan) {
+            shmWrite(dst, off, buffer.getReadPointer(chan), m_reqHeader.samples * sizeof(T));
+        }
+        shmWrite(dst, off, m_midiData.data(), m_reqHeader.midiBytes);
+        shmWrite(dst, off, &posInfo, sizeof(posInfo));
+        m_capture->commitFrame(off);
+    }
+
+    void captureRaw(const char* frame, uint32_t size) {
+        char* dst = m_capture->beginFrame(size);
+        if (nullptr != dst) {
+            memcpy(dst, frame, size);
+            m_capture->commitFrame(size);
+        }
+    }
+
+    void addToVec(const void* data, size_t size) {
+        if (size > 0) {
+            m_iov.push_back({const_cast<void*>(data), size});
+        }
+    }
+
+    template <typename T>
+    void addChannelsToVec(AudioBuffer<T>& buffer, int channels, int samples) {
+        if (m_wireFlags & AUDIO_WIRE_INT16) {
+            if (m_wireData.size() < static_cast<size_t>(channels * samples)) {
+                m_wireData.resize(channels * samples);
+            }
+            for (int chan = 0; chan < channels; ++chan) {
+                auto* src = buffer.getReadPointer(chan);
+                auto* dst = m_wireData.data() + chan * samples;
+                for (int s = 0; s < samples; ++s) {
+                    // TPDF dither at 1 LSB, this mode is meant for monitoring-only chains
+                    auto v = static_cast<float>(src[s]) + (m_dither.nextFloat() - m_dither.nextFloat()) / 32768.0f;
+                    dst[s] = static_cast<int16_t>(jlimit(-1.0f, 1.0f, v) * 32767.0f);
+                }
+                addToVec(dst, samples * sizeof(int16_t));
+            }
+        } else {
+            for (int chan = 0; chan < channels; ++chan) {
+                addToVec(buffer.getReadPointer(chan), samples * sizeof(T));
+            }
+        }
+    }
+
+    template <typename T>
+    bool readChannels(StreamingSocket* socket, AudioBuffer<T>& buffer, int channels, int samples,
+                      int timeoutMilliseconds = 0, MessageHelper::Error* e = nullptr) {
+        if (m_wireFlags & AUDIO_WIRE_INT16) {
+            if (m_wireData.size() < static_cast<size_t>(samples)) {
+                m_wireData.resize(samples);
+            }
+            for (int chan = 0; chan < channels; ++chan) {
+                if (!read(socket, m_wireData.data(), samples * sizeof(int16_t), timeoutMilliseconds, e)) {
+                    return false;
+                }
+                auto* dst = buffer.getWritePointer(chan);
+                for (int s = 0; s < samples; ++s) {
+                    dst[s] = static_cast<T>(m_wireData[s] / 32768.0f);
+                }
+            }
+        } else {
+            for (int chan = 0; chan < channels; ++chan) {
+                if (!read(socket, buffer.getWritePointer(chan), samples * sizeof(T), timeoutMilliseconds, e)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Packs the whole MidiBuffer into one contiguous [MidiHeader, data]... region, so it goes out
+    // as a single fragment instead of two writes per event.
+    size_t serializeMidi(MidiBuffer& midi) {
+        m_midiData.clear();  // keeps the capacity
+        MidiHeader midiHdr;
+        const uint8* midiData;
+        MidiBuffer::Iterator midiIt(midi);
+        while (midiIt.getNextEvent(midiData, midiHdr.size, midiHdr.sampleNumber)) {
+            auto* hdr = reinterpret_cast<const char*>(&midiHdr);
+            m_midiData.insert(m_midiData.end(), hdr, hdr + sizeof(midiHdr));
+            auto* data = reinterpret_cast<const char*>(midiData);
+            m_midiData.insert(m_midiData.end(), data, data + midiHdr.size);
+        }
+        return m_midiData.size();
+    }
+
+    bool readMidi(StreamingSocket* socket, MidiBuffer& midi, int numEvents, int bytes, int timeoutMilliseconds = 0,
+                  MessageHelper::Error* e = nullptr) {
+        midi.clear();
+        if (bytes <= 0) {
+            return true;
+        }
+        if (m_midiData.size() < static_cast<size_t>(bytes)) {
+            m_midiData.resize(bytes);
+        }
+        if (!read(socket, m_midiData.data(), bytes, timeoutMilliseconds, e)) {
+            return false;
+        }
+        return parseMidi(midi, m_midiData.data(), bytes, numEvents, e);
+    }
+
+    bool parseMidi(MidiBuffer& midi, const char* p, int bytes, int numEvents, MessageHelper::Error* e) {
+        midi.clear();
+        const char* end = p + bytes;
+        for (int i = 0; i < numEvents && p + sizeof(MidiHeader) <= end; i++) {
+            MidiHeader midiHdr;
+            memcpy(&midiHdr, p, sizeof(midiHdr));
+            p += sizeof(midiHdr);
+            if (midiHdr.size < 0 || p + midiHdr.size > end) {
+                MessageHelper::seterr(e, MessageHelper::E_DATA);
+                return false;
+            }
+            midi.addEvent(p, midiHdr.size, midiHdr.sampleNumber);
+            p += midiHdr.size;
+        }
+        return true;
+    }
+
+    static void shmWrite(char* base, size_t& off, const void* src, size_t size) {
+        memcpy(base + off, src, size);
+        off += size;
+    }
+
+    static bool shmRead(const char* base, size_t& off, size_t total, void* dst, size_t size) {
+        if (off + size > total) {
+            return false;
+        }
+        memcpy(dst, base + off, size);
+        off += size;
+        return true;
+    }
+
+    template <typename T>
+    bool parseResponse(const char* src, uint32_t size, AudioBuffer<T>& buffer, MidiBuffer& midi,
+                       MessageHelper::Error* e) {
+        size_t off = 0;
+        bool success = shmRead(src, off, size, &m_resHeader, sizeof(m_resHeader));
+        for (int chan = 0; success && chan < buffer.getNumChannels(); ++chan) {
+            success = shmRead(src, off, size, buffer.getWritePointer(chan), buffer.getNumSamples() * sizeof(T));
+        }
+        if (success) {
+            success = off + m_resHeader.midiBytes <= size &&
+                      parseMidi(midi, src + off, m_resHeader.midiBytes, m_resHeader.numMidiEvents, e);
+        }
+        if (!success) {
+            MessageHelper::seterr(e, MessageHelper::E_DATA);
+            return false;
+        }
+        MessageHelper::seterr(e, MessageHelper::E_NONE);
+        return true;
+    }
+
+    bool parseRequest(const char* src, uint32_t size, AudioBuffer<float>& bufferF, AudioBuffer<double>& bufferD,
+                      MidiBuffer& midi, AudioPlayHead::CurrentPositionInfo& posInfo, int extraChannels) {
+        size_t off = 0;
+        bool success = shmRead(src, off, size, &m_reqHeader, sizeof(m_reqHeader));
+        if (success) {
+            int channels = m_reqHeader.channels + extraChannels;
+            if (m_reqHeader.isDouble) {
+                bufferD.setSize(channels, m_reqHeader.samples);
+                for (int chan = m_reqHeader.channels; chan < channels; ++chan) {
+                    bufferD.clear(chan, 0, m_reqHeader.samples);
+                }
+                for (int chan = 0; success && chan < m_reqHeader.channels; ++chan) {
+                    success =
+                        shmRead(src, off, size, bufferD.getWritePointer(chan), m_reqHeader.samples * sizeof(double));
+                }
+            } else {
+                bufferF.setSize(channels, m_reqHeader.samples);
+                for (int chan = m_reqHeader.channels; chan < channels; ++chan) {
+                    bufferF.clear(chan, 0, m_reqHeader.samples);
+                }
+                for (int chan = 0; success && chan < m_reqHeader.channels; ++chan) {
+                    success =
+                        shmRead(src, off, size, bufferF.getWritePointer(chan), m_reqHeader.samples * sizeof(float));
+                }
+            }
+        }
+        if (success) {
+            success = off + m_reqHeader.midiBytes <= size &&
+                      parseMidi(midi, src + off, m_reqHeader.midiBytes, m_reqHeader.numMidiEvents, nullptr);
+            off += m_reqHeader.midiBytes;
+        }
+        if (success) {
+            success = shmRead(src, off, size, &posInfo, sizeof(posInfo));
+        }
+        return success;
+    }
+
+    // Delivers the next block payload in sequence order. A packet that arrives ahead of the
+    // expected one is parked for a short reordering window; when the gap does not fill in time
+    // the parked packet is delivered and the missing ones are counted as lost.
+    bool udpReceive(DatagramSocket& socket, int timeoutMilliseconds, const char*& payload, uint32_t& size) {
+        if (m_udpHasHeld && m_udpHeldSeq == m_udpRecvSeq) {
+            m_udpHasHeld = false;
+            m_udpRecvSeq++;
+            payload = m_udpHeld.data();
+            size = static_cast<uint32_t>(m_udpHeld.size());
+            return true;
+        }
+        if (m_packet.size() < UDP_MAX_PACKET) {
+            m_packet.resize(UDP_MAX_PACKET);
+        }
+        auto until = Time::getMillisecondCounterHiRes() + timeoutMilliseconds;
+        // while a packet is parked, only wait one block period or so for the gap to fill
+        auto reorderUntil = Time::getMillisecondCounterHiRes() + 2;
+        for (;;) {
+            auto now = Time::getMillisecondCounterHiRes();
+            if (now > until || (m_udpHasHeld && now > reorderUntil)) {
+                if (m_udpHasHeld) {
+                    // give up on the gap, the skipped packets are lost
+                    m_udpHasHeld = false;
+                    m_udpRecvSeq = m_udpHeldSeq + 1;
+                    payload = m_udpHeld.data();
+                    size = static_cast<uint32_t>(m_udpHeld.size());
+                    return true;
+                }
+                return false;
+            }
+            if (socket.waitUntilReady(true, 1) <= 0) {
+                continue;
+            }
+            int len = socket.read(m_packet.data(), static_cast<int>(m_packet.size()), false);
+            if (len < static_cast<int>(sizeof(uint32_t))) {
+                continue;
+            }
+            uint32_t seq;
+            memcpy(&seq, m_packet.data(), sizeof(seq));
+            if (len == sizeof(uint32_t) || seq < m_udpRecvSeq) {
+                continue;  // hello packet, duplicate or late straggler
+            }
+            if (seq == m_udpRecvSeq) {
+                m_udpRecvSeq++;
+                payload = m_packet.data() + sizeof(seq);
+                size = static_cast<uint32_t>(len) - sizeof(seq);
+                return true;
+            }
+            // ahead of the expected one, park it (keep the earliest when several pile up)
+            if (!m_udpHasHeld || seq < m_udpHeldSeq) {
+                m_udpHeld.assign(m_packet.data() + sizeof(seq), m_packet.data() + len);
+                m_udpHeldSeq = seq;
+                if (!m_udpHasHeld) {
+                    reorderUntil = Time::getMillisecondCounterHiRes() + 2;
+                }
+                m_udpHasHeld = true;
+            }
+        }
+    }
+
+    static char* waitWriteSlot(SharedMemoryRing& ring, size_t needed) {
+        if (needed > ring.getSlotSize()) {
+            // should not happen with sane ring sizing
+            return nullptr;
+        }
+        auto until = Time::getMillisecondCounterHiRes() + 1000;
+        char* dst;
+        while (nullptr == (dst = ring.beginWrite())) {
+            if (Time::getMillisecondCounterHiRes() > until) {
+                return nullptr;
+            }
+            usleep(100);
+        }
+        return dst;
+    }
 };
 
 /*
@@ -322,6 +858,9 @@ class Payload {
 
     virtual void realign() {}
 
+    // invoked once the payload buffer holds a complete message body
+    virtual void afterRead() {}
+
     int payloadType;
     Buffer payloadBuffer;
 };
@@ -375,12 +914,49 @@ class BinaryPayload : public Payload {
     int* size;
     char* data;
 
+    // Settings blobs of sampler/convolution plugins easily reach multiple MB, some beyond
+    // MAX_SIZE. Blobs above the threshold get deflated transparently at set time and inflated
+    // right after the read, a negative length marks a deflated blob on the wire. Senders talking
+    // to a peer older than protocol version 4 have to clear allowCompression.
+    static constexpr int COMPRESS_THRESHOLD = 64 * 1024;
+
+    bool allowCompression = true;
+
     BinaryPayload(int type) : Payload(type, sizeof(int)) { realign(); }
 
     void setData(const char* src, int len) {
-        setSize(sizeof(int) + len);
+        if (allowCompression && len > COMPRESS_THRESHOLD) {
+            MemoryOutputStream mos;
+            {
+                GZIPCompressorOutputStream gz(&mos, 1, false);
+                gz.write(src, static_cast<size_t>(len));
+            }
+            if (mos.getDataSize() < static_cast<size_t>(len)) {
+                setSize(sizeof(int) + mos.getDataSize());
+                *size = -static_cast<int>(mos.getDataSize());
+                memcpy(data, mos.getData(), mos.getDataSize());
+                return;
+            }
+        }
+        setSize(sizeof(int) + static_cast<size_t>(len));
         *size = len;
-        memcpy(data, src, len);
+        if (len > 0) {
+            memcpy(data, src, len);
+        }
+    }
+
+    virtual void afterRead() override {
+        if (getSize() >= sizeof(int) && *size < 0) {
+            MemoryBlock block;
+            {
+                MemoryInputStream mis(data, static_cast<size_t>(-*size), false);
+                GZIPDecompressorInputStream gz(&mis, false);
+                gz.readIntoMemoryBlock(block);
+            }
+            setSize(sizeof(int) + block.getSize());
+            *size = static_cast<int>(block.getSize());
+            memcpy(data, block.getData(), block.getSize());
+        }
     }
 
     virtual void realign() override {
@@ -435,10 +1011,12 @@ struct preparetoplay_data_t {
     int samples;
 };
 
-class PluginList : public StringPayload {
+// Carries the deflated plugin list text, an empty payload tells the client that its cached list
+// is still current.
+class PluginList : public BinaryPayload {
   public:
     static constexpr int Type = 3;
-    PluginList() : StringPayload(Type) {}
+    PluginList() : BinaryPayload(Type) {}
 };
 
 class AddPlugin : public StringPayload {
@@ -469,7 +1047,21 @@ class ScreenCapture : public Payload {
   public:
     static constexpr int Type = 8;
 
+    // tile codecs, the header announces what the server encoded with and the client follows
+    static constexpr int CODEC_PNG = 0;
+    static constexpr int CODEC_RAW_GZ = 1;  // raw ARGB rows through zlib at the fastest level
+
     struct hdr_t {
+        int width;
+        int height;
+        int numTiles;  // > 0: the data carries tile_t records, 0: a full frame image
+        int codec;
+        size_t size;
+    };
+    // a dirty tile of the editor image, followed by its encoded pixel data
+    struct tile_t {
+        int x;
+        int y;
         int width;
         int height;
         size_t size;
@@ -483,6 +1075,8 @@ class ScreenCapture : public Payload {
         setSize(sizeof(hdr_t) + size);
         hdr->width = width;
         hdr->height = height;
+        hdr->numTiles = 0;
+        hdr->codec = 0;
         hdr->size = size;
         if (nullptr != p) {
             memcpy(data, p, size);
@@ -606,6 +1200,110 @@ class Preset : public DataPayload<preset_t> {
     Preset() : DataPayload<preset_t>(Type) {}
 };
 
+// Carries the whole chain in one packed payload, in both directions: the client sends plugin
+// IDs, bypass states and settings blobs to restore a session in a single round trip, or an
+// empty payload to query the settings of every loaded plugin for saving.
+class ChainSnapshot : public BinaryPayload {
+  public:
+    static constexpr int Type = 22;
+    ChainSnapshot() : BinaryPayload(Type) {}
+};
+
+// An array of (pluginIdx, paramIdx, value) triplets, used in both directions: bulk sets from
+// the client and proactive value pushes from the server while the remote editor UI is open.
+class ParameterValuesBatch : public BinaryPayload {
+  public:
+    static constexpr int Type = 23;
+    ParameterValuesBatch() : BinaryPayload(Type) {}
+
+    void setValues(const std::vector<parametervalue_t>& values) {
+        setData(reinterpret_cast<const char*>(values.data()),
+                static_cast<int>(values.size() * sizeof(parametervalue_t)));
+    }
+
+    const parametervalue_t* getValues(int& count) const {
+        count = *size / static_cast<int>(sizeof(parametervalue_t));
+        return reinterpret_cast<const parametervalue_t*>(data);
+    }
+};
+
+// Presets and parameter metadata are fetched lazily after AddPlugin, so inserting a preset-rich
+// plugin returns as soon as the latency is known.
+class GetPresets : public NumberPayload {
+  public:
+    static constexpr int Type = 24;
+    GetPresets() : NumberPayload(Type) {}
+};
+
+class GetParameters : public NumberPayload {
+  public:
+    static constexpr int Type = 25;
+    GetParameters() : NumberPayload(Type) {}
+};
+
+// packed parameter metadata records (see Worker::writeParameters), the reply to GetParameters
+class ParametersPacked : public BinaryPayload {
+  public:
+    static constexpr int Type = 26;
+    ParametersPacked() : BinaryPayload(Type) {}
+};
+
+// Effective processing precision of the chain, 1 when every loaded plugin supports double
+// precision. Sent with the latency updates, a version 5+ client stops sending doubles that the
+// server would convert down anyways and halves the audio bandwidth.
+class ChainPrecision : public NumberPayload {
+  public:
+    static constexpr int Type = 27;
+    ChainPrecision() : NumberPayload(Type) {}
+};
+
+// Load metric of a server (see Server::getLoadInfo), the answer to a HANDSHAKE_PROBE. Clients
+// use it to place new chains on the least loaded server of a group.
+class ServerLoad : public JsonPayload {
+  public:
+    static constexpr int Type = 28;
+    ServerLoad() : JsonPayload(Type) {}
+};
+
+// One slice of a ScreenCapture frame in mux mode (WIRE_MUX). Frames get chunked on the shared
+// command connection, so a command reply waits behind at most MAX_CHUNK bytes of screen data in
+// the send buffer instead of a whole frame.
+class ScreenChunk : public Payload {
+  public:
+    static constexpr int Type = 29;
+    static constexpr size_t MAX_CHUNK = 32 * 1024;
+
+    struct hdr_t {
+        size_t frameSize;  // payload size of the reassembled ScreenCapture message
+        size_t offset;
+        size_t size;
+    };
+    hdr_t* hdr;
+    char* data;
+
+    ScreenChunk() : Payload(Type) { realign(); }
+
+    void setChunk(size_t frameSize, size_t offset, size_t size) {
+        setSize(sizeof(hdr_t) + size);
+        hdr->frameSize = frameSize;
+        hdr->offset = offset;
+        hdr->size = size;
+    }
+
+    virtual void realign() override {
+        hdr = reinterpret_cast<hdr_t*>(payloadBuffer.data());
+        data = getSize() > sizeof(hdr_t) ? reinterpret_cast<char*>(payloadBuffer.data()) + sizeof(hdr_t) : nullptr;
+    }
+};
+
+// Per-plugin processing time statistics of the chain (see ProcessorChain::getProcTimes), sent as
+// a request with an empty payload and answered with one json record per loaded plugin.
+class ProcTimes : public JsonPayload {
+  public:
+    static constexpr int Type = 30;
+    ProcTimes() : JsonPayload(Type) {}
+};
+
 template <typename T>
 class Message {
   public:
@@ -648,6 +1346,8 @@ class Message {
                                     std::cerr << "failed to read message body" << std::endl;
                                     success = false;
                                     MessageHelper::seterr(e, MessageHelper::E_DATA);
+                                } else {
+                                    payload.afterRead();
                                 }
                             }
                         }
@@ -686,6 +1386,24 @@ class Message {
         return true;
     }
 
+    // Scatter variant of send: writes the payload header and the data block straight from the
+    // caller's buffers in one writev, skipping the memcpy into the payload vector.
+    bool sendScatter(StreamingSocket* socket, const void* hdrData, size_t hdrSize, const void* data, size_t size) {
+        Header hdr = {payload.getType(), (int)(hdrSize + size)};
+        if (hdr.size > MAX_SIZE) {
+            std::cerr << "max size of " << MAX_SIZE << " bytes exceeded (" << hdr.size << " bytes)" << std::endl;
+            return false;
+        }
+        struct iovec iov[3];
+        iov[0].iov_base = &hdr;
+        iov[0].iov_len = sizeof(hdr);
+        iov[1].iov_base = const_cast<void*>(hdrData);
+        iov[1].iov_len = hdrSize;
+        iov[2].iov_base = const_cast<void*>(data);
+        iov[2].iov_len = size;
+        return e47::sendv(socket, iov, size > 0 ? 3 : 2);
+    }
+
     int getType() const { return payload.getType(); }
     size_t getSize() const { return payload.getSize(); }
     const char* getData() const { return payload.getData(); }
@@ -695,12 +1413,32 @@ class Message {
         auto out = std::make_shared<Message<T2>>();
         out->payload.payloadBuffer = std::move(in->payload.payloadBuffer);
         out->payload.realign();
+        out->payload.afterRead();
         return out;
     }
 
     T payload;
 };
 
+// Typed view over the payload buffer of a raw message: the buffer is borrowed via a swap and
+// handed back on destruction, so dispatching a message costs no heap allocation for the body.
+// The view must not outlive the message it was created from.
+template <typename T>
+class MessageView : public Message<T> {
+  public:
+    explicit MessageView(Message<Any>& source) : m_source(source) {
+        this->payload.payloadBuffer.swap(source.payload.payloadBuffer);
+        this->payload.setType(T::Type);
+        this->payload.realign();
+        this->payload.afterRead();
+    }
+
+    ~MessageView() override { this->payload.payloadBuffer.swap(m_source.payload.payloadBuffer); }
+
+  private:
+    Message<Any>& m_source;
+};
+
 #define PLD(m) m.payload
 #define pPLD(m) m->payload
 #define DATA(m) PLD(m).data
@@ -718,6 +1456,12 @@ class MessageFactory {
         return nullptr;
     }
 
+    // Pooling variant: reads into a caller owned message, so a command loop can reuse one message
+    // object and its buffer keeps the high water mark capacity instead of reallocating per message.
+    static bool getNextMessage(StreamingSocket* socket, Message<Any>& msg, MessageHelper::Error* e) {
+        return nullptr != socket && msg.read(socket, e);
+    }
+
     static std::shared_ptr<Result> getResult(StreamingSocket* socket, int retry = 5) {
         if (nullptr != socket) {
             auto msg = std::make_shared<Message<Result>>();
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#include "Metrics.hpp"
+
+namespace e47 {
+
+std::unordered_map<std::string, std::weak_ptr<Metrics::Channel>> Metrics::m_channels;
+std::mutex Metrics::m_channelsMtx;
+
+json Metrics::Histogram::toJson() const {
+    json j;
+    uint64_t total = count.load();
+    j["count"] = total;
+    j["avgUs"] = total > 0 ? sumUs.load() / total : 0;
+    json jbins = json::array();
+    for (int i = 0; i < NUM_BINS; i++) {
+        jbins.push_back(bins[i].load());
+    }
+    // bin i counts samples in [2^i, 2^(i+1)) microseconds
+    j["binsPow2Us"] = jbins;
+    return j;
+}
+
+json Metrics::Channel::toJson() const {
+    json j;
+    j["blocks"] = blocks.load();
+    j["inStarved"] = inStarved.load();
+    j["outBackpressure"] = outBackpressure.load();
+    j["procTime"] = procTime.toJson();
+    j["netRead"] = netRead.toJson();
+    j["netWrite"] = netWrite.toJson();
+    return j;
+}
+
+std::shared_ptr<Metrics::Channel> Metrics::createChannel(const String& name) {
+    auto channel = std::make_shared<Channel>();
+    std::lock_guard<std::mutex> lock(m_channelsMtx);
+    m_channels[name.toStdString()] = channel;
+    return channel;
+}
+
+json Metrics::dump() {
+    json j;
+    j["connections"] = json::object();
+    std::lock_guard<std::mutex> lock(m_channelsMtx);
+    for (auto it = m_channels.begin(); it != m_channels.end();) {
+        if (auto channel = it->second.lock()) {
+            j["connections"][it->first] = channel->toJson();
+            it++;
+        } else {
+            it = m_channels.erase(it);
+        }
+    }
+    return j;
+}
+
+}  // namespace e47
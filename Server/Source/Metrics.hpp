@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#ifndef Metrics_hpp
+#define Metrics_hpp
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "json.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace e47 {
+
+// Always-on instrumentation for the audio path. Recording is a handful of relaxed atomic
+// increments, cheap enough to stay enabled in release builds; the dump side runs on the metrics
+// port and never touches the audio threads.
+class Metrics {
+  public:
+    // Fixed power-of-two bins in microseconds: bin i counts samples in [2^i, 2^(i+1)). The top
+    // bin collects everything from ~0.25s up.
+    struct Histogram {
+        static constexpr int NUM_BINS = 18;
+
+        std::atomic<uint64_t> bins[NUM_BINS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sumUs{0};
+
+        void record(double ms) {
+            auto us = static_cast<uint64_t>(ms * 1000);
+            int bin = 0;
+            while ((us >> (bin + 1)) != 0 && bin < NUM_BINS - 1) {
+                bin++;
+            }
+            bins[bin].fetch_add(1, std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+            sumUs.fetch_add(us, std::memory_order_relaxed);
+        }
+
+        json toJson() const;
+    };
+
+    // Instrument set of one audio connection, owned by its AudioWorker and referenced weakly by
+    // the registry, so a dead connection ages out with its worker.
+    struct Channel {
+        Histogram procTime;   // chain processing per block
+        Histogram netRead;    // receiving a block from the client, includes waiting for it
+        Histogram netWrite;   // flushing a processed block back
+        std::atomic<uint64_t> blocks{0};
+        std::atomic<uint64_t> inStarved{0};        // DSP thread found no input block ready
+        std::atomic<uint64_t> outBackpressure{0};  // DSP thread found the out slot still busy
+
+        json toJson() const;
+    };
+
+    static std::shared_ptr<Channel> createChannel(const String& name);
+    static json dump();
+
+  private:
+    static std::unordered_map<std::string, std::weak_ptr<Channel>> m_channels;
+    static std::mutex m_channelsMtx;
+};
+
+}  // namespace e47
+
+#endif /* Metrics_hpp */
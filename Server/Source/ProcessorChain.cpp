@@ -8,9 +8,124 @@
 #include "ProcessorChain.hpp"
 #include "Utils.hpp"
 
+#include <unistd.h>
+
+#include <algorithm>
+
 namespace e47 {
 
-std::mutex ProcessorChain::m_pluginLoaderMtx;
+// Plugin instantiation is serialized per format: binaries of the same format share framework
+// state that is not safe to initialize concurrently, but chains loading different formats can
+// proceed in parallel.
+static std::mutex& pluginLoaderMtx(const String& format) {
+    static std::mutex mtxAU, mtxVST3, mtxOther;
+    if (format == "AudioUnit") {
+        return mtxAU;
+    }
+    if (format == "VST3") {
+        return mtxVST3;
+    }
+    return mtxOther;
+}
+
+HashMap<String, ProcessorChain::WarmPoolEntry> ProcessorChain::m_warmPool;
+std::mutex ProcessorChain::m_warmPoolMtx;
+int ProcessorChain::m_warmPoolSize = 0;
+
+ProcessorChain::Pipeline::Pipeline(ProcessorChain& chain, int numStages)
+    : m_chain(chain), m_numStages(numStages), m_slots(static_cast<size_t>(numStages) + 1) {
+    for (int i = 0; i < m_numStages; i++) {
+        m_threads.push_back(std::make_unique<StageThread>(*this, i));
+        m_threads.back()->startThread(Thread::realtimeAudioPriority);
+    }
+}
+
+ProcessorChain::Pipeline::~Pipeline() {
+    m_shutdown = true;
+    for (auto& t : m_threads) {
+        t->stopThread(1000);
+    }
+}
+
+bool ProcessorChain::Pipeline::waitFull(Slot& slot) {
+    int spins = 0;
+    while (!slot.full) {
+        if (m_shutdown || ++spins > 20000) {  // roughly a second
+            return false;
+        }
+        usleep(50);
+    }
+    return !m_shutdown;
+}
+
+bool ProcessorChain::Pipeline::waitEmpty(Slot& slot) {
+    int spins = 0;
+    while (slot.full) {
+        if (m_shutdown || ++spins > 20000) {
+            return false;
+        }
+        usleep(50);
+    }
+    return !m_shutdown;
+}
+
+void ProcessorChain::Pipeline::StageThread::run() {
+    if (int cores = getApp().getServer().getAudioCores()) {
+        setCurrentThreadAffinity(ThreadGroup::AUDIO, cores);
+    }
+    auto& in = m_pipe.m_slots[static_cast<size_t>(m_idx)];
+    auto& out = m_pipe.m_slots[static_cast<size_t>(m_idx) + 1];
+    while (!currentThreadShouldExit()) {
+        if (!m_pipe.waitFull(in)) {
+            continue;
+        }
+        auto procs = std::atomic_load(&m_pipe.m_chain.m_procsSnapshot);
+        auto stats = std::atomic_load(&m_pipe.m_chain.m_statsSnapshot);
+        int num = static_cast<int>(procs->size());
+        int begin = num * m_idx / m_pipe.m_numStages;
+        int end = num * (m_idx + 1) / m_pipe.m_numStages;
+        for (int i = begin; i < end; i++) {
+            auto& p = (*procs)[static_cast<size_t>(i)];
+            if (!p->isSuspended()) {
+                auto start = Time::getHighResolutionTicks();
+                if (in.isDouble) {
+                    p->processBlock(in.audioD, in.midi);
+                } else {
+                    p->processBlock(in.audioF, in.midi);
+                }
+                if (static_cast<size_t>(i) < stats->size()) {
+                    (*stats)[static_cast<size_t>(i)]->record(
+                        Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000);
+                }
+            }
+        }
+        if (!m_pipe.waitEmpty(out)) {
+            continue;
+        }
+        // hand the block over by swapping buffers, no copying between stages
+        std::swap(out.audioF, in.audioF);
+        std::swap(out.audioD, in.audioD);
+        out.midi.swapWith(in.midi);
+        out.isDouble = in.isDouble;
+        out.full = true;
+        in.full = false;
+    }
+}
+
+void ProcessorChain::setPipelineStages(int stages) {
+    int num = jlimit(0, 16, stages);
+    if (num == getPipelineStages() || (num < 2 && getPipelineStages() == 0)) {
+        return;
+    }
+    std::shared_ptr<Pipeline> pipeline;
+    if (num > 1) {
+        pipeline = std::make_shared<Pipeline>(*this, num);
+        logln("chain pipeline enabled with " << num << " stages");
+    } else {
+        logln("chain pipeline disabled");
+    }
+    std::atomic_store(&m_pipeline, pipeline);
+}
 
 void ProcessorChain::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) {
     setRateAndBufferSizeDetails(sampleRate, maximumExpectedSamplesPerBlock);
@@ -32,6 +147,7 @@ void ProcessorChain::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMe
     processBlockReal(buffer, midiMessages);
     auto end_proc = Time::getHighResolutionTicks();
     double time_proc = Time::highResolutionTicksToSeconds(end_proc - start_proc);
+    m_procTimeAvgMs = m_procTimeAvgMs * 0.95 + time_proc * 1000 * 0.05;
     if (time_proc > 0.02) {
         dbgln("warning: chain (" << toString() << "): high audio processing time: " << time_proc);
     }
@@ -42,6 +158,7 @@ void ProcessorChain::processBlock(AudioBuffer<double>& buffer, MidiBuffer& midiM
     processBlockReal(buffer, midiMessages);
     auto end_proc = Time::getHighResolutionTicks();
     double time_proc = Time::highResolutionTicksToSeconds(end_proc - start_proc);
+    m_procTimeAvgMs = m_procTimeAvgMs * 0.95 + time_proc * 1000 * 0.05;
     if (time_proc > 0.02) {
         dbgln("warning: chain (" << toString() << "): high audio processing time: " << time_proc);
     }
@@ -102,7 +219,7 @@ bool ProcessorChain::setProcessorBusesLayout(std::shared_ptr<AudioPluginInstance
             layout.outputBuses.add(bus);
         }
         if (proc->checkBusesLayoutSupported(layout) && proc->setBusesLayout(layout)) {
-            m_extraChannels = jmax(m_extraChannels, extraInChannels, extraOutChannels);
+            m_extraChannels = jmax(m_extraChannels.load(), extraInChannels, extraOutChannels);
             logln(extraInChannels << " extra input(s), " << extraOutChannels << " extra output(s)");
             return true;
         }
@@ -110,26 +227,73 @@ bool ProcessorChain::setProcessorBusesLayout(std::shared_ptr<AudioPluginInstance
     return false;
 }
 
-int ProcessorChain::getExtraChannels() {
-    std::lock_guard<std::mutex> lock(m_processors_mtx);
-    return m_extraChannels;
-}
+int ProcessorChain::getExtraChannels() { return m_extraChannels; }
 
 // Sync version.
 std::shared_ptr<AudioPluginInstance> ProcessorChain::loadPlugin(PluginDescription& plugdesc, double sampleRate,
                                                                 int blockSize) {
+    // adopt a warm instance if one is available, this skips the expensive construction
+    {
+        std::lock_guard<std::mutex> lock(m_warmPoolMtx);
+        auto& entry = m_warmPool.getReference(plugdesc.fileOrIdentifier);
+        if (!entry.instances.isEmpty()) {
+            auto inst = entry.instances.getLast();
+            entry.instances.removeLast();
+            m_warmPoolSize--;
+            if (entry.hasDefaultState) {
+                inst->setStateInformation(entry.defaultState.getData(), (int)entry.defaultState.getSize());
+            }
+            inst->reset();
+            logln_static("adopted warm instance of " << plugdesc.fileOrIdentifier);
+            return inst;
+        }
+    }
     String err;
     AudioPluginFormatManager plugmgr;
     plugmgr.addDefaultFormats();
-    std::lock_guard<std::mutex> lock(m_pluginLoaderMtx);  // don't load plugins in parallel
+    std::lock_guard<std::mutex> lock(pluginLoaderMtx(plugdesc.pluginFormatName));
     auto inst =
         std::shared_ptr<AudioPluginInstance>(plugmgr.createPluginInstance(plugdesc, sampleRate, blockSize, err));
     if (nullptr == inst) {
         logln_static("failed loading plugin " << plugdesc.fileOrIdentifier << ": " << err);
+    } else {
+        // remember the pristine state, adopted instances get reset to it
+        std::lock_guard<std::mutex> poolLock(m_warmPoolMtx);
+        auto& entry = m_warmPool.getReference(plugdesc.fileOrIdentifier);
+        if (!entry.hasDefaultState) {
+            inst->getStateInformation(entry.defaultState);
+            entry.hasDefaultState = true;
+        }
     }
     return inst;
 }
 
+void ProcessorChain::recycleProcessor(std::shared_ptr<AudioPluginInstance> proc) {
+    if (nullptr == proc) {
+        return;
+    }
+    proc->releaseResources();
+    proc->setPlayHead(nullptr);
+    proc->suspendProcessing(false);
+    auto id = proc->getPluginDescription().fileOrIdentifier;
+    std::lock_guard<std::mutex> lock(m_warmPoolMtx);
+    auto& entry = m_warmPool.getReference(id);
+    if (entry.instances.size() < WARM_POOL_MAX_PER_PLUGIN && m_warmPoolSize < WARM_POOL_MAX_TOTAL) {
+        entry.instances.add(proc);
+        m_warmPoolSize++;
+        logln_static("keeping instance of " << id << " warm (pool size is " << m_warmPoolSize << ")");
+    }
+}
+
+void ProcessorChain::clearWarmPool() {
+    std::lock_guard<std::mutex> lock(m_warmPoolMtx);
+    if (m_warmPoolSize > 0) {
+        logln_static("dropping " << m_warmPoolSize << " warm plugin instance(s)");
+    }
+    m_warmPool.clear();
+    m_warmPoolSize = 0;
+}
+
 std::shared_ptr<AudioPluginInstance> ProcessorChain::loadPlugin(const String& fileOrIdentifier, double sampleRate,
                                                                 int blockSize) {
     auto& pluglist = getApp().getPluginList();
@@ -173,26 +337,33 @@ bool ProcessorChain::addPluginProcessor(const String& fileOrIdentifier) {
 bool ProcessorChain::addProcessor(std::shared_ptr<AudioPluginInstance> processor) {
     std::lock_guard<std::mutex> lock(m_processors_mtx);
     m_processors.push_back(processor);
+    m_procStats.push_back(std::make_shared<ProcTimeStats>());
     updateNoLock();
     return true;
 }
 
 void ProcessorChain::delProcessor(int idx) {
-    int i = 0;
-    std::lock_guard<std::mutex> lock(m_processors_mtx);
-    for (auto it = m_processors.begin(); it < m_processors.end(); it++) {
-        if (i++ == idx) {
-            m_processors.erase(it);
-            break;
+    std::shared_ptr<AudioPluginInstance> removed;
+    {
+        int i = 0;
+        std::lock_guard<std::mutex> lock(m_processors_mtx);
+        for (auto it = m_processors.begin(); it < m_processors.end(); it++) {
+            if (i++ == idx) {
+                removed = *it;
+                m_processors.erase(it);
+                m_procStats.erase(m_procStats.begin() + idx);
+                break;
+            }
         }
+        updateNoLock();
     }
-    updateNoLock();
+    recycleProcessor(removed);
 }
 
 void ProcessorChain::updateNoLock() {
     int latency = 0;
     bool supportsDouble = true;
-    m_extraChannels = 0;
+    int extraChannels = 0;
     for (auto& proc : m_processors) {
         latency += proc->getLatencySamples();
         if (!proc->supportsDoublePrecisionProcessing()) {
@@ -200,8 +371,9 @@ void ProcessorChain::updateNoLock() {
         }
         int extraInChannels = proc->getTotalNumInputChannels() - proc->getMainBusNumInputChannels();
         int extraOutChannels = proc->getTotalNumOutputChannels() - proc->getMainBusNumOutputChannels();
-        m_extraChannels = jmax(m_extraChannels, extraInChannels, extraOutChannels);
+        extraChannels = jmax(extraChannels, extraInChannels, extraOutChannels);
     }
+    m_extraChannels = extraChannels;
     if (latency != getLatencySamples()) {
         dbgln("updating latency samples to " << latency);
         setLatencySamples(latency);
@@ -212,12 +384,19 @@ void ProcessorChain::updateNoLock() {
     } else {
         m_tailSecs = 0.0;
     }
+    publishNoLock();
+}
+
+void ProcessorChain::publishNoLock() {
+    std::atomic_store(&m_procsSnapshot,
+                      std::shared_ptr<const ProcessorList>(std::make_shared<ProcessorList>(m_processors)));
+    std::atomic_store(&m_statsSnapshot, std::shared_ptr<const StatsList>(std::make_shared<StatsList>(m_procStats)));
 }
 
 std::shared_ptr<AudioPluginInstance> ProcessorChain::getProcessor(int index) {
-    std::lock_guard<std::mutex> lock(m_processors_mtx);
-    if (index > -1 && index < m_processors.size()) {
-        return m_processors[index];
+    auto procs = std::atomic_load(&m_procsSnapshot);
+    if (index > -1 && index < procs->size()) {
+        return (*procs)[index];
     }
     return nullptr;
 }
@@ -226,13 +405,15 @@ void ProcessorChain::exchangeProcessors(int idxA, int idxB) {
     std::lock_guard<std::mutex> lock(m_processors_mtx);
     if (idxA > -1 && idxB < m_processors.size() && idxB > -1 && idxB < m_processors.size()) {
         std::swap(m_processors[idxA], m_processors[idxB]);
+        std::swap(m_procStats[static_cast<size_t>(idxA)], m_procStats[static_cast<size_t>(idxB)]);
+        publishNoLock();
     }
 }
 
 float ProcessorChain::getParameterValue(int idx, int paramIdx) {
-    std::lock_guard<std::mutex> lock(m_processors_mtx);
-    if (idx > -1 && idx < m_processors.size()) {
-        for (auto& p : m_processors[idx]->getParameters()) {
+    auto procs = std::atomic_load(&m_procsSnapshot);
+    if (idx > -1 && idx < procs->size()) {
+        for (auto& p : (*procs)[idx]->getParameters()) {
             if (paramIdx == p->getParameterIndex()) {
                 return p->getValue();
             }
@@ -243,15 +424,46 @@ float ProcessorChain::getParameterValue(int idx, int paramIdx) {
 
 void ProcessorChain::clear() {
     releaseResources();
-    std::lock_guard<std::mutex> lock(m_processors_mtx);
-    m_processors.clear();
+    ProcessorList removed;
+    {
+        std::lock_guard<std::mutex> lock(m_processors_mtx);
+        removed.swap(m_processors);
+        m_procStats.clear();
+        publishNoLock();
+    }
+    for (auto& proc : removed) {
+        recycleProcessor(proc);
+    }
+}
+
+json ProcessorChain::getProcTimes() {
+    json j = json::array();
+    auto procs = std::atomic_load(&m_procsSnapshot);
+    auto stats = std::atomic_load(&m_statsSnapshot);
+    for (size_t i = 0; i < procs->size() && i < stats->size(); i++) {
+        auto& st = *(*stats)[i];
+        size_t num = jmin(static_cast<size_t>(st.count.load()), static_cast<size_t>(ProcTimeStats::RING_SIZE));
+        std::vector<float> ring(st.ringMs, st.ringMs + num);
+        std::sort(ring.begin(), ring.end());
+        auto pct = [&ring](double p) {
+            return ring.empty() ? 0.0
+                                : static_cast<double>(ring[jmin(ring.size() - 1,
+                                                                static_cast<size_t>(p * static_cast<double>(ring.size())))]);
+        };
+        j.push_back({{"name", (*procs)[i]->getName().toStdString()},
+                     {"avgMs", st.avgMs.load()},
+                     {"p50Ms", pct(0.5)},
+                     {"p95Ms", pct(0.95)},
+                     {"p99Ms", pct(0.99)}});
+    }
+    return j;
 }
 
 String ProcessorChain::toString() {
     String ret;
-    std::lock_guard<std::mutex> lock(m_processors_mtx);
+    auto procs = std::atomic_load(&m_procsSnapshot);
     bool first = true;
-    for (auto& p : m_processors) {
+    for (auto& p : *procs) {
         if (!first) {
             ret << " > ";
         } else {
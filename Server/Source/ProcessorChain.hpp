@@ -9,6 +9,9 @@
 #define ProcessorChain_hpp
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "json.hpp"
+
+using json = nlohmann::json;
 
 namespace e47 {
 
@@ -44,6 +47,14 @@ class ProcessorChain : public AudioProcessor {
     bool setProcessorBusesLayout(std::shared_ptr<AudioPluginInstance> proc);
     int getExtraChannels();
 
+    // exponential moving average over the recent blocks, feeds the load metric of the server
+    double getAverageProcessTimeMs() const { return m_procTimeAvgMs; }
+
+    // per-plugin processing times, one json record per plugin in chain order with rolling
+    // average and percentiles over the recent blocks, so the hog of a misbehaving chain shows
+    // up without bisecting by hand
+    json getProcTimes();
+
     bool acceptsMidi() const override { return false; };
     bool producesMidi() const override { return false; };
     AudioProcessorEditor* createEditor() override { return nullptr; }
@@ -60,9 +71,115 @@ class ProcessorChain : public AudioProcessor {
                                                            int blockSize);
     static std::shared_ptr<AudioPluginInstance> loadPlugin(const String& fileOrIdentifier, double sampleRate,
                                                            int blockSize);
+    // empties the warm pool, called from App::shutdown on the message thread: plugin teardown
+    // must not happen during static deinitialization after the message loop is gone
+    static void clearWarmPool();
+    using ProcessorList = std::vector<std::shared_ptr<AudioPluginInstance>>;
+
+    /*
+     * Opt-in multi-core execution for long chains: the processor list is partitioned into
+     * contiguous stages running on dedicated threads, each handing its block to the next stage
+     * through a single-depth lock-free slot. Trades (stages - 1) blocks of added latency
+     * (reported through the regular latency accounting) for near-linear chain throughput scaling.
+     */
+    class Pipeline {
+      public:
+        Pipeline(ProcessorChain& chain, int numStages);
+        ~Pipeline();
+
+        int getNumStages() const { return m_numStages; }
+
+        template <typename T>
+        void process(AudioBuffer<T>& buffer, MidiBuffer& midi) {
+            auto& in = m_slots[0];
+            auto& out = m_slots[static_cast<size_t>(m_numStages)];
+            if (!waitEmpty(in)) {
+                return;
+            }
+            writeSlot(in, buffer, midi);
+            in.full = true;
+            if (m_primed < m_numStages - 1) {
+                // the pipeline is still filling up, hand back silence
+                m_primed++;
+                buffer.clear();
+                midi.clear();
+                return;
+            }
+            if (!waitFull(out)) {
+                buffer.clear();
+                midi.clear();
+                return;
+            }
+            readSlot(out, buffer, midi);
+            out.full = false;
+        }
+
+      private:
+        struct Slot {
+            AudioBuffer<float> audioF;
+            AudioBuffer<double> audioD;
+            MidiBuffer midi;
+            bool isDouble = false;
+            std::atomic_bool full{false};
+        };
+
+        class StageThread : public Thread {
+          public:
+            StageThread(Pipeline& pipe, int idx) : Thread("ChainStage"), m_pipe(pipe), m_idx(idx) {}
+            void run() override;
+
+          private:
+            Pipeline& m_pipe;
+            int m_idx;
+        };
+
+        ProcessorChain& m_chain;
+        int m_numStages;
+        int m_primed = 0;
+        std::atomic_bool m_shutdown{false};
+        std::vector<Slot> m_slots;  // m_slots[i] feeds stage i, the last one holds the output
+        std::vector<std::unique_ptr<StageThread>> m_threads;
+
+        bool waitFull(Slot& slot);
+        bool waitEmpty(Slot& slot);
+
+        static void writeSlot(Slot& slot, AudioBuffer<float>& buffer, MidiBuffer& midi) {
+            slot.audioF.makeCopyOf(buffer);
+            slot.isDouble = false;
+            copyMidi(slot.midi, midi);
+        }
+
+        static void writeSlot(Slot& slot, AudioBuffer<double>& buffer, MidiBuffer& midi) {
+            slot.audioD.makeCopyOf(buffer);
+            slot.isDouble = true;
+            copyMidi(slot.midi, midi);
+        }
+
+        static void readSlot(Slot& slot, AudioBuffer<float>& buffer, MidiBuffer& midi) {
+            buffer.makeCopyOf(slot.audioF);
+            copyMidi(midi, slot.midi);
+        }
+
+        static void readSlot(Slot& slot, AudioBuffer<double>& buffer, MidiBuffer& midi) {
+            buffer.makeCopyOf(slot.audioD);
+            copyMidi(midi, slot.midi);
+        }
+
+        static void copyMidi(MidiBuffer& dst, MidiBuffer& src) {
+            dst.clear();
+            dst.addEvents(src, 0, src.getNumEvents(), 0);
+        }
+    };
+
+    void setPipelineStages(int stages);
+    int getPipelineStages() {
+        auto pipeline = std::atomic_load(&m_pipeline);
+        return nullptr != pipeline ? pipeline->getNumStages() : 0;
+    }
+
     bool addPluginProcessor(const String& fileOrIdentifier);
     bool addProcessor(std::shared_ptr<AudioPluginInstance> processor);
-    size_t getSize() const { return m_processors.size(); }
+    size_t getSize() const { return std::atomic_load(&m_procsSnapshot)->size(); }
     std::shared_ptr<AudioPluginInstance> getProcessor(int index);
 
     void delProcessor(int idx);
@@ -75,25 +192,81 @@ class ProcessorChain : public AudioProcessor {
     String toString();
 
   private:
-    std::vector<std::shared_ptr<AudioPluginInstance>> m_processors;
+    // Master copy, only touched under m_processors_mtx by the command thread. The audio thread
+    // never takes the lock: every edit publishes a new immutable snapshot (RCU style), readers
+    // atomically load it and work on a list that cannot change under them.
+    ProcessorList m_processors;
     std::mutex m_processors_mtx;
+    std::shared_ptr<const ProcessorList> m_procsSnapshot = std::make_shared<const ProcessorList>();
+    std::shared_ptr<Pipeline> m_pipeline;
 
-    static std::mutex m_pluginLoaderMtx;
+    // Per-plugin timing ring, written by the audio thread only. Query readers copy the ring
+    // without locking, a torn float during a concurrent write skews one percentile at worst.
+    struct ProcTimeStats {
+        static constexpr int RING_SIZE = 256;
+        std::atomic<double> avgMs{0.0};
+        float ringMs[RING_SIZE] = {0};
+        std::atomic<uint32_t> count{0};
+
+        void record(double ms) {
+            avgMs = avgMs * 0.95 + ms * 0.05;
+            ringMs[count++ % RING_SIZE] = static_cast<float>(ms);
+        }
+    };
+    using StatsList = std::vector<std::shared_ptr<ProcTimeStats>>;
+    StatsList m_procStats;  // master copy, kept in sync with m_processors under the mutex
+    std::shared_ptr<const StatsList> m_statsSnapshot = std::make_shared<const StatsList>();
+
+    // Warm pool of released plugin instances, keyed by the plugin file/identifier and shared by
+    // all chains: adopting a pooled instance skips the full createPluginInstance cost (sample
+    // library mapping, resource init). Each entry keeps the pristine state captured right after
+    // the first construction, so adopted instances start clean.
+    struct WarmPoolEntry {
+        Array<std::shared_ptr<AudioPluginInstance>> instances;
+        MemoryBlock defaultState;
+        bool hasDefaultState = false;
+    };
+    static constexpr int WARM_POOL_MAX_PER_PLUGIN = 2;
+    static constexpr int WARM_POOL_MAX_TOTAL = 16;
+    static HashMap<String, WarmPoolEntry> m_warmPool;
+    static std::mutex m_warmPoolMtx;
+    static int m_warmPoolSize;
+
+    static void recycleProcessor(std::shared_ptr<AudioPluginInstance> proc);
 
     std::atomic_bool m_supportsDoublePrecission{true};
     std::atomic<double> m_tailSecs{0.0};
+    std::atomic<double> m_procTimeAvgMs{0.0};
 
-    int m_extraChannels = 0;
+    std::atomic<int> m_extraChannels{0};
 
     template <typename T>
     void processBlockReal(AudioBuffer<T>& buffer, MidiBuffer& midiMessages) {
         int latency = 0;
-        std::lock_guard<std::mutex> lock(m_processors_mtx);
-        for (auto& p : m_processors) {
+        auto procs = std::atomic_load(&m_procsSnapshot);
+        auto pipeline = std::atomic_load(&m_pipeline);
+        if (nullptr != pipeline && procs->size() > 1) {
+            for (auto& p : *procs) {
+                latency += p->getLatencySamples();
+            }
+            latency += (pipeline->getNumStages() - 1) * getBlockSize();
+            setLatencySamples(latency);
+            pipeline->process(buffer, midiMessages);
+            return;
+        }
+        auto stats = std::atomic_load(&m_statsSnapshot);
+        size_t idx = 0;
+        for (auto& p : *procs) {
             if (!p->isSuspended()) {
+                auto start = Time::getHighResolutionTicks();
                 p->processBlock(buffer, midiMessages);
+                if (idx < stats->size()) {
+                    (*stats)[idx]->record(
+                        Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000);
+                }
             }
             latency += p->getLatencySamples();
+            idx++;
         }
         setLatencySamples(latency);
     }
@@ -112,6 +285,7 @@ class ProcessorChain : public AudioProcessor {
     }
 
     void updateNoLock();
+    void publishNoLock();
 };
 
 }  // namespace e47
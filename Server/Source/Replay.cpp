@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Defaults.hpp"
+#include "Message.hpp"
+#include "StreamCapture.hpp"
+
+namespace e47 {
+
+bool Replay::run(const String& file, const String& host, int port, double speed, const StringArray& plugins) {
+    CaptureReader reader;
+    if (!reader.open(file)) {
+        std::cerr << "failed to open capture " << file.toStdString() << std::endl;
+        return false;
+    }
+    auto& hdr = reader.getHeader();
+    std::cout << "capture: " << hdr.numFrames << " frames, " << hdr.channels << " channels, " << hdr.rate << " Hz, "
+              << hdr.samplesPerBlock << " samples/block" << std::endl;
+
+    // the precision travels per frame, peek at the first one for the handshake
+    uint32 frameSize;
+    const char* frame = reader.nextFrame(frameSize);
+    if (nullptr == frame || frameSize < sizeof(AudioMessage::RequestHeader)) {
+        std::cerr << "empty capture" << std::endl;
+        return false;
+    }
+    AudioMessage::RequestHeader reqHdr;
+    memcpy(&reqHdr, frame, sizeof(reqHdr));
+    reader.rewind();
+
+    // the server dials back to the client port for audio and screen, just like for a real client
+    StreamingSocket listener;
+    int clientPort = 0;
+    for (int retry = 0; retry < 200; retry++) {
+        if (listener.createListener(DEFAULT_CLIENT_PORT - retry)) {
+            clientPort = DEFAULT_CLIENT_PORT - retry;
+            break;
+        }
+    }
+    if (clientPort == 0) {
+        std::cerr << "failed to create a listener" << std::endl;
+        return false;
+    }
+
+    StreamingSocket cmd;
+    if (!cmd.connect(host, port, 1000)) {
+        std::cerr << "failed to connect to " << host.toStdString() << ":" << port << std::endl;
+        return false;
+    }
+    Handshake cfg = {7, clientPort, hdr.channels, hdr.rate, hdr.samplesPerBlock, reqHdr.isDouble, 0, 0, 0};
+    if (!e47::send(&cmd, reinterpret_cast<const char*>(&cfg), sizeof(cfg))) {
+        std::cerr << "handshake failed" << std::endl;
+        return false;
+    }
+    std::unique_ptr<StreamingSocket> audioSock(listener.waitForNextConnection());
+    std::unique_ptr<StreamingSocket> screenSock(listener.waitForNextConnection());
+    if (nullptr == audioSock || nullptr == screenSock) {
+        std::cerr << "server did not connect back" << std::endl;
+        return false;
+    }
+
+    // plugin list (or a refusal) followed by the session resume result
+    auto msgAny = std::make_shared<Message<Any>>();
+    if (!msgAny->read(&cmd, nullptr, 5000)) {
+        std::cerr << "failed to read the plugin list" << std::endl;
+        return false;
+    }
+    if (msgAny->getType() == Result::Type) {
+        auto res = Message<Any>::convert<Result>(msgAny);
+        std::cerr << "server refused the connection: " << pPLD(res).getString().toStdString() << std::endl;
+        return false;
+    }
+    Message<Result> resume;
+    if (!resume.read(&cmd, nullptr, 5000)) {
+        std::cerr << "failed to read the resume result" << std::endl;
+        return false;
+    }
+
+    // restore the chain to benchmark, empty settings, same exchange as Client::addPlugins
+    if (!plugins.isEmpty()) {
+        MemoryOutputStream mos;
+        mos.writeInt(plugins.size());
+        for (auto& id : plugins) {
+            mos.writeString(id);
+            mos.writeBool(false);
+            mos.writeInt(0);
+        }
+        Message<ChainSnapshot> snap;
+        PLD(snap).setData(static_cast<const char*>(mos.getData()), static_cast<int>(mos.getDataSize()));
+        if (!snap.send(&cmd)) {
+            std::cerr << "failed to send the chain snapshot" << std::endl;
+            return false;
+        }
+        Message<ChainSnapshot> ret;
+        MessageHelper::Error err;
+        int attempts = 120;
+        while (!ret.read(&cmd, &err)) {
+            if (err != MessageHelper::E_TIMEOUT || --attempts < 1) {
+                std::cerr << "failed to read the chain snapshot result" << std::endl;
+                return false;
+            }
+        }
+        MemoryInputStream mis(PLD(ret).data, static_cast<size_t>(*PLD(ret).size), false);
+        int num = mis.readInt();
+        for (int i = 0; i < num && i < plugins.size(); i++) {
+            if (!mis.readBool()) {
+                std::cerr << "failed to load " << plugins[i].toStdString() << std::endl;
+                return false;
+            }
+        }
+        std::cout << "loaded " << num << " plugin(s), chain latency " << mis.readInt() << " samples" << std::endl;
+    }
+
+    // Lockstep replay: send a block, wait for its result, so every sample is a full round trip
+    // through transport and DSP. Pacing sleeps towards the capture's block grid scaled by speed,
+    // speed 0 streams as fast as the server answers.
+    double blockPeriodMs = hdr.samplesPerBlock * 1000.0 / hdr.rate;
+    std::vector<double> rtts;
+    rtts.reserve(static_cast<size_t>(hdr.numFrames));
+    AudioMessage msg;
+    AudioBuffer<float> bufF;
+    AudioBuffer<double> bufD;
+    MidiBuffer midi;
+    auto start = Time::getMillisecondCounterHiRes();
+    uint64 blocks = 0;
+    while (nullptr != (frame = reader.nextFrame(frameSize))) {
+        if (speed > 0) {
+            double due = start + blocks * blockPeriodMs / speed;
+            double now = Time::getMillisecondCounterHiRes();
+            if (now < due) {
+                Thread::sleep(static_cast<int>(due - now));
+            }
+        }
+        // the frame is stored in wire layout, re-stamp the send time and push it through as is
+        memcpy(&reqHdr, frame, sizeof(reqHdr));
+        reqHdr.sentAt = Time::getMillisecondCounterHiRes();
+        if (!e47::send(audioSock.get(), reinterpret_cast<const char*>(&reqHdr), sizeof(reqHdr)) ||
+            !e47::send(audioSock.get(), frame + sizeof(reqHdr), static_cast<int>(frameSize - sizeof(reqHdr)))) {
+            std::cerr << "failed to send block " << blocks << std::endl;
+            return false;
+        }
+        MessageHelper::Error err;
+        bool success;
+        if (reqHdr.isDouble) {
+            bufD.setSize(reqHdr.channels, reqHdr.samples);
+            success = msg.readFromServer(audioSock.get(), bufD, midi, &err);
+        } else {
+            bufF.setSize(reqHdr.channels, reqHdr.samples);
+            success = msg.readFromServer(audioSock.get(), bufF, midi, &err);
+        }
+        if (!success) {
+            std::cerr << "failed to read block " << blocks << ", error code " << err << std::endl;
+            return false;
+        }
+        rtts.push_back(Time::getMillisecondCounterHiRes() - reqHdr.sentAt);
+        blocks++;
+    }
+    auto seconds = jmax(1e-3, (Time::getMillisecondCounterHiRes() - start) / 1000);
+
+    Message<Quit> quit;
+    quit.send(&cmd);
+
+    if (rtts.empty()) {
+        std::cerr << "no blocks replayed" << std::endl;
+        return false;
+    }
+    double sum = 0;
+    for (auto v : rtts) {
+        sum += v;
+    }
+    std::sort(rtts.begin(), rtts.end());
+    auto pct = [&rtts](double p) { return rtts[jmin(rtts.size() - 1, static_cast<size_t>(p * rtts.size()))]; };
+    double audioSeconds = blocks * hdr.samplesPerBlock / hdr.rate;
+    std::cout << "replayed " << blocks << " blocks in " << String(seconds, 2).toStdString() << " s ("
+              << String(blocks / seconds, 1).toStdString() << " blocks/s, "
+              << String(audioSeconds / seconds, 2).toStdString() << "x realtime)" << std::endl;
+    std::cout << "round trip ms: avg " << String(sum / static_cast<double>(rtts.size()), 3).toStdString() << "  p50 "
+              << String(pct(0.5), 3).toStdString() << "  p95 " << String(pct(0.95), 3).toStdString() << "  p99 "
+              << String(pct(0.99), 3).toStdString() << "  max " << String(rtts.back(), 3).toStdString() << std::endl;
+    return true;
+}
+
+}  // namespace e47
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#ifndef Replay_hpp
+#define Replay_hpp
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+namespace e47 {
+
+// Entry point of the -replay command line mode (see App::initialise): connects to a server like a
+// plugin client, drives it with a captured audio request stream (see StreamCapture) at a
+// configurable speed and reports throughput and the per-block round trip distribution to stdout.
+class Replay {
+  public:
+    static bool run(const String& file, const String& host, int port, double speed, const StringArray& plugins);
+};
+
+}  // namespace e47
+
+#endif /* Replay_hpp */
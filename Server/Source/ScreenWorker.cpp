@@ -13,30 +13,74 @@
 namespace e47 {
 
 ScreenWorker::~ScreenWorker() {
-    if (nullptr != m_socket && m_socket->isConnected()) {
-        m_socket->close();
+    if (nullptr != m_ownedSocket && m_ownedSocket->isConnected()) {
+        m_ownedSocket->close();
     }
     stopThread(-1);
 }
 
-void ScreenWorker::init(std::unique_ptr<StreamingSocket> s) { m_socket = std::move(s); }
+void ScreenWorker::init(std::unique_ptr<StreamingSocket> s) {
+    m_ownedSocket = std::move(s);
+    m_socket = m_ownedSocket.get();
+}
+
+void ScreenWorker::init(StreamingSocket* sharedSocket, std::mutex* sendMtx) {
+    m_socket = sharedSocket;
+    m_sendMtx = sendMtx;
+}
 
 void ScreenWorker::run() {
+    if (int cores = getApp().getServer().getAudioCores()) {
+        setCurrentThreadAffinity(ThreadGroup::HOUSEKEEPING, cores);
+    }
     Message<ScreenCapture> msg;
-    float qual = getApp().getServer().getScreenQuality();
+    float qualCfg = getApp().getServer().getScreenQuality();
+    float qual = qualCfg;
     PNGImageFormat png;
     JPEGImageFormat jpg;
     bool diffDetect = getApp().getServer().getScreenDiffDetection();
+    // PNG is the wrong trade for an interactive stream, compressing the raw tile bytes with zlib
+    // at the fastest level cuts the encode time by an order of magnitude
+    int codec = getApp().getServer().getScreenFastCodec() ? ScreenCapture::CODEC_RAW_GZ : ScreenCapture::CODEC_PNG;
+    // bandwidth budget as a token bucket with one second of burst headroom, refilled continuously
+    double budget = getApp().getServer().getScreenBandwidthBudget() * 1024.0;
+    double allowance = budget;
+    double lastRefillAt = Time::getMillisecondCounterHiRes();
+    double lastFrameAt = 0;
+    double frameCostMs = 0;  // EWMA of diff+encode+send per frame, the backpressure signal
     uint32_t captureCount = 0;
+    std::vector<bool> dirtyTiles;
+    // recycled across frames to avoid regrowing the encode buffers on every update
+    MemoryOutputStream mos, tileData;
     while (!currentThreadShouldExit() && nullptr != m_socket && m_socket->isConnected()) {
         std::unique_lock<std::mutex> lock(m_currentImageLock);
         m_currentImageCv.wait(lock, [this] { return m_updated; });
         m_updated = false;
 
+        flushParameterChanges();
+
+        // Coalesce repaints to the target frame rate: a plugin with an animated analyzer repaints
+        // far more often than anybody looks at it remotely. The stream runs at the active rate
+        // while the user interacts, drops to the idle rate otherwise, and never sends faster than
+        // the last frame took to process (a backed up socket pushes the send time up). Repaints
+        // arriving during the wait just replace m_currentImage, only the latest snapshot gets
+        // encoded. Parameter changes flush right away.
+        double interval = jmax(1000.0 / (isInteracting() ? ACTIVE_FPS : IDLE_FPS), frameCostMs);
+        for (;;) {
+            double wait = lastFrameAt + interval - Time::getMillisecondCounterHiRes();
+            if (wait <= 0 || currentThreadShouldExit() || nullptr == m_currentImage) {
+                break;
+            }
+            m_currentImageCv.wait_for(lock, std::chrono::milliseconds((int)wait + 1));
+            m_updated = false;
+            flushParameterChanges();
+        }
+
         if (nullptr != m_currentImage) {
+            double frameStart = Time::getMillisecondCounterHiRes();
             std::shared_ptr<Image> imgToSend = m_currentImage;
             bool needsBrightnessCheckOrRefresh = (captureCount++ % 20) == 0;
-            bool forceFullImg = !diffDetect || needsBrightnessCheckOrRefresh;  // send a full image once per second
+            bool forceFullImg = !diffDetect || needsBrightnessCheckOrRefresh;  // refresh every tile once per second
 
             // For some reason the plugin window turns white or black sometimes, this should be investigated..
             // For now as a hack: Check if the image is mostly white, and reset the plugin window in this case.
@@ -44,16 +88,18 @@ void ScreenWorker::run() {
             float mostlyBlack = 0.1;
             float brightness = mostlyWhite / 2;
 
-            // Calculate the difference between the current and the last image
+            // Find the tiles that changed between the current and the last image actually sent,
+            // so the changes of repaints skipped by the pacing stay contained
             uint64_t diffPxCount = m_width * m_height;
-            if (!forceFullImg && m_lastImage != nullptr && m_currentImage->getBounds() == m_lastImage->getBounds() &&
-                m_diffImage != nullptr) {
-                brightness = 0;
-                diffPxCount = ImageDiff::getDelta(
-                    *m_lastImage, *m_currentImage, *m_diffImage,
-                    [&brightness](const PixelARGB& px) { brightness += ImageDiff::getBrightness(px); });
-                imgToSend = m_diffImage;
-            } else if (needsBrightnessCheckOrRefresh && !diffDetect) {
+            if (diffDetect) {
+                if (!forceFullImg && m_lastImage != nullptr &&
+                    m_currentImage->getBounds() == m_lastImage->getBounds()) {
+                    diffPxCount = ImageDiff::getDirtyTiles(*m_lastImage, *m_currentImage, dirtyTiles, &brightness);
+                } else {
+                    dirtyTiles.assign((size_t)ImageDiff::getNumTilesX(m_width) * ImageDiff::getNumTilesY(m_height),
+                                      true);
+                }
+            } else if (needsBrightnessCheckOrRefresh) {
                 brightness = ImageDiff::getBrightness(*imgToSend);
             }
 
@@ -63,14 +109,44 @@ void ScreenWorker::run() {
                 MessageManager::callAsync([] { getApp().restartEditor(); });
             } else {
                 if (diffPxCount > 0) {
-                    MemoryOutputStream mos;
+                    mos.reset();
+                    int numTiles = 0;
                     if (diffDetect) {
-                        png.writeImageToStream(*imgToSend, mos);
+                        int tilesX = ImageDiff::getNumTilesX(m_width);
+                        for (size_t t = 0; t < dirtyTiles.size(); t++) {
+                            if (!dirtyTiles[t]) {
+                                continue;
+                            }
+                            int x = ((int)t % tilesX) * ImageDiff::TILE_SIZE;
+                            int y = ((int)t / tilesX) * ImageDiff::TILE_SIZE;
+                            ScreenCapture::tile_t tile = {x, y, jmin(ImageDiff::TILE_SIZE, m_width - x),
+                                                          jmin(ImageDiff::TILE_SIZE, m_height - y), 0};
+                            tileData.reset();
+                            if (codec == ScreenCapture::CODEC_RAW_GZ) {
+                                const Image::BitmapData bd(*imgToSend, tile.x, tile.y, tile.width, tile.height);
+                                GZIPCompressorOutputStream gz(&tileData, 1, false);
+                                for (int l = 0; l < tile.height; l++) {
+                                    gz.write(bd.getLinePointer(l), (size_t)tile.width * bd.pixelStride);
+                                }
+                                gz.flush();
+                            } else {
+                                png.writeImageToStream(
+                                    imgToSend->getClippedImage({tile.x, tile.y, tile.width, tile.height}), tileData);
+                            }
+                            tile.size = tileData.getDataSize();
+                            mos.write(&tile, sizeof(tile));
+                            mos.write(tileData.getData(), tileData.getDataSize());
+                            numTiles++;
+                        }
                     } else {
                         jpg.setQuality(qual);
                         jpg.writeImageToStream(*imgToSend, mos);
                     }
 
+                    // advance the diff baseline to this snapshot, the periodic full refresh heals
+                    // the rare case of the frame not making it out below
+                    m_lastImage = imgToSend;
+
                     lock.unlock();
 
                     if (mos.getDataSize() > Message<ScreenCapture>::MAX_SIZE) {
@@ -82,21 +158,106 @@ void ScreenWorker::run() {
                                 "increased.");
                         }
                     } else {
-                        msg.payload.setImage(m_width, m_height, mos.getData(), mos.getDataSize());
-                        msg.send(m_socket.get());
+                        if (budget > 0) {
+                            double now = Time::getMillisecondCounterHiRes();
+                            allowance = jmin(budget, allowance + (now - lastRefillAt) * budget / 1000);
+                            lastRefillAt = now;
+                            if (mos.getDataSize() > allowance) {
+                                // over budget: stall until the bucket covers the frame and trade
+                                // quality for rate where the codec has that lever
+                                if (!diffDetect && qual > 0.2f) {
+                                    qual -= 0.05f;
+                                }
+                                // bounded so a tiny budget cannot hold up a shutdown for long
+                                Thread::sleep(jmin(1000, (int)((mos.getDataSize() - allowance) * 1000 / budget) + 1));
+                                double after = Time::getMillisecondCounterHiRes();
+                                allowance = jmin(budget, allowance + (after - lastRefillAt) * budget / 1000);
+                                lastRefillAt = after;
+                            } else if (!diffDetect && qual < qualCfg) {
+                                // ease back toward the configured quality while under budget
+                                qual = jmin(qualCfg, qual + 0.01f);
+                            }
+                            allowance -= mos.getDataSize();
+                        }
+                        // scatter-send the header and the encoded data straight from the encode
+                        // buffer, no copy into the payload
+                        ScreenCapture::hdr_t hdr = {m_width, m_height, numTiles, codec, mos.getDataSize()};
+                        sendFrame(msg, &hdr, sizeof(hdr), mos.getData(), mos.getDataSize());
+                        double now = Time::getMillisecondCounterHiRes();
+                        lastFrameAt = now;
+                        frameCostMs = frameCostMs * 0.9 + (now - frameStart) * 0.1;
                     }
                 }
             }
-        } else {
+        } else if (currentThreadShouldExit()) {
             // another client took over, notify this one
             msg.payload.setImage(0, 0, nullptr, 0);
-            msg.send(m_socket.get());
+            sendMsg(msg);
         }
     }
     hideEditor();
     logln("screen processor terminated");
 }
 
+void ScreenWorker::pushParameterChange(int idx, int paramIdx, float val) {
+    {
+        std::lock_guard<std::mutex> lock(m_paramChangesMtx);
+        m_paramChanges.push_back({idx, paramIdx, val});
+    }
+    // wake the sender, the push should not wait for the next frame
+    std::lock_guard<std::mutex> lock(m_currentImageLock);
+    m_updated = true;
+    m_currentImageCv.notify_one();
+}
+
+void ScreenWorker::flushParameterChanges() {
+    std::vector<parametervalue_t> changes;
+    {
+        std::lock_guard<std::mutex> lock(m_paramChangesMtx);
+        changes.swap(m_paramChanges);
+    }
+    if (!changes.empty() && nullptr != m_socket && m_socket->isConnected()) {
+        Message<ParameterValuesBatch> msg;
+        PLD(msg).setValues(changes);
+        sendMsg(msg);
+    }
+}
+
+// Without mux the frame goes out as one scatter write on the dedicated screen socket. On the
+// shared command connection it gets sliced into ScreenChunk messages with the send mutex held
+// per chunk, so a pending command reply waits for one chunk at most.
+bool ScreenWorker::sendFrame(Message<ScreenCapture>& msg, const void* hdrData, size_t hdrSize, const void* data,
+                             size_t size) {
+    if (nullptr == m_sendMtx) {
+        return msg.sendScatter(m_socket, hdrData, hdrSize, data, size);
+    }
+    Message<ScreenChunk> chunk;
+    size_t total = hdrSize + size;
+    for (size_t offset = 0; offset < total; offset += ScreenChunk::MAX_CHUNK) {
+        size_t len = jmin(ScreenChunk::MAX_CHUNK, total - offset);
+        PLD(chunk).setChunk(total, offset, len);
+        // a chunk can span the frame header and the encoded data
+        char* dst = PLD(chunk).data;
+        size_t srcOff = offset;
+        size_t remain = len;
+        if (srcOff < hdrSize) {
+            size_t n = jmin(hdrSize - srcOff, remain);
+            memcpy(dst, static_cast<const char*>(hdrData) + srcOff, n);
+            dst += n;
+            srcOff += n;
+            remain -= n;
+        }
+        if (remain > 0) {
+            memcpy(dst, static_cast<const char*>(data) + (srcOff - hdrSize), remain);
+        }
+        std::lock_guard<std::mutex> lock(*m_sendMtx);
+        if (!chunk.send(m_socket)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void ScreenWorker::shutdown() {
     signalThreadShouldExit();
     std::lock_guard<std::mutex> lock(m_currentImageLock);
@@ -116,12 +277,7 @@ void ScreenWorker::showEditor(std::shared_ptr<AudioProcessor> proc) {
         getApp().showEditor(proc, tid, [this](std::shared_ptr<Image> i, int w, int h) {
             if (nullptr != i) {
                 std::lock_guard<std::mutex> lock(m_currentImageLock);
-                m_lastImage = m_currentImage;
                 m_currentImage = i;
-                if (m_lastImage == nullptr || m_lastImage->getBounds() != m_currentImage->getBounds() ||
-                    m_diffImage == nullptr) {
-                    m_diffImage = std::make_shared<Image>(Image::ARGB, w, h, false);
-                }
                 m_width = w;
                 m_height = h;
                 m_updated = true;
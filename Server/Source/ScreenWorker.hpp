@@ -9,7 +9,9 @@
 #define ScreenWorker_hpp
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "Message.hpp"
 
+#include <atomic>
 #include <thread>
 
 namespace e47 {
@@ -20,20 +22,61 @@ class ScreenWorker : public Thread {
     virtual ~ScreenWorker();
 
     void init(std::unique_ptr<StreamingSocket> s);
+    // mux mode: screen traffic shares the command connection, frames go out chunked and every
+    // write holds the send mutex so command replies interleave between chunks
+    void init(StreamingSocket* sharedSocket, std::mutex* sendMtx);
     void run();
     void shutdown();
 
     void showEditor(std::shared_ptr<AudioProcessor> proc);
     void hideEditor();
 
+    // queues a value change of the edited plugin, sent to the client with the next flush
+    void pushParameterChange(int idx, int paramIdx, float val);
+
+    // called for every key/mouse message from the client, the frame pacing runs at the active
+    // rate while the user interacts with the editor and drops to the idle rate otherwise
+    void noteUserActivity() { m_lastActivityAt = Time::getMillisecondCounterHiRes(); }
+
   private:
-    std::unique_ptr<StreamingSocket> m_socket;
-    std::shared_ptr<Image> m_currentImage, m_lastImage, m_diffImage;
+    // frame pacing targets, a frame additionally never goes out faster than the last one took to
+    // encode and send
+    static constexpr double ACTIVE_FPS = 30.0;
+    static constexpr double IDLE_FPS = 5.0;
+    static constexpr double ACTIVITY_WINDOW_MS = 2000.0;
+
+    std::unique_ptr<StreamingSocket> m_ownedSocket;
+    StreamingSocket* m_socket = nullptr;
+    std::mutex* m_sendMtx = nullptr;  // set in mux mode only
+    // m_lastImage is the last frame that actually went out, the diff baseline: the frame pacing
+    // may skip repaints, their changes still have to travel with the next sent frame
+    std::shared_ptr<Image> m_currentImage, m_lastImage;
     int m_width;
     int m_height;
     bool m_updated = false;
     std::mutex m_currentImageLock;
     std::condition_variable m_currentImageCv;
+    std::vector<parametervalue_t> m_paramChanges;
+    std::mutex m_paramChangesMtx;
+    std::atomic<double> m_lastActivityAt{0.0};
+
+    bool isInteracting() const {
+        return Time::getMillisecondCounterHiRes() - m_lastActivityAt.load(std::memory_order_relaxed) <
+               ACTIVITY_WINDOW_MS;
+    }
+
+    void flushParameterChanges();
+
+    bool sendFrame(Message<ScreenCapture>& msg, const void* hdrData, size_t hdrSize, const void* data, size_t size);
+
+    template <typename T>
+    bool sendMsg(Message<T>& msg) {
+        if (nullptr != m_sendMtx) {
+            std::lock_guard<std::mutex> lock(*m_sendMtx);
+            return msg.send(m_socket);
+        }
+        return msg.send(m_socket);
+    }
 };
 
 }  // namespace e47
@@ -6,6 +6,11 @@
  */
 
 #include <sys/socket.h>
+
+#include <atomic>
+#include <iostream>
+
+#include "Metrics.hpp"
 #include "Server.hpp"
 #include "Utils.hpp"
 #include "json.hpp"
@@ -41,6 +46,34 @@ void Server::loadConfig() {
             m_screenDiffDetection = j["ScreenDiffDetection"].get<bool>();
             logln("Screen capture difference detection " << (m_screenDiffDetection ? "enabled" : "disabled"));
         }
+        if (j.find("ScreenFastCodec") != j.end()) {
+            m_screenFastCodec = j["ScreenFastCodec"].get<bool>();
+            logln("Screen capture fast tile codec " << (m_screenFastCodec ? "enabled" : "disabled"));
+        }
+        if (j.find("ScreenBandwidthBudget") != j.end()) {
+            m_screenBandwidthBudget = j["ScreenBandwidthBudget"].get<int>();
+            if (m_screenBandwidthBudget > 0) {
+                logln("limiting screen streams to " << m_screenBandwidthBudget << " KB/s per editor");
+            }
+        }
+        if (j.find("ChainPipelineStages") != j.end()) {
+            m_chainPipelineStages = j["ChainPipelineStages"].get<int>();
+            logln("chain pipelining across " << m_chainPipelineStages << " stages");
+        }
+        if (j.find("MaxAudioWorkers") != j.end()) {
+            m_maxAudioWorkers = j["MaxAudioWorkers"].get<int>();
+            logln("limiting the server to " << m_maxAudioWorkers << " concurrent clients");
+        }
+        if (j.find("AudioCores") != j.end()) {
+            m_audioCores = j["AudioCores"].get<int>();
+            logln("reserving " << m_audioCores << " cores for audio threads");
+        }
+        if (j.find("CaptureStream") != j.end()) {
+            m_captureStreamPath = j["CaptureStream"].get<std::string>();
+            if (m_captureStreamPath.isNotEmpty()) {
+                logln("capturing audio request streams to " << m_captureStreamPath << ".<port>.agcap");
+            }
+        }
         if (j.find("ExcludePlugins") != j.end()) {
             for (auto& s : j["ExcludePlugins"]) {
                 m_pluginexclude.insert(s.get<std::string>());
@@ -66,6 +99,12 @@ void Server::saveConfig() {
     j["VST"] = m_enableVST;
     j["ScreenQuality"] = m_screenJpgQuality;
     j["ScreenDiffDetection"] = m_screenDiffDetection;
+    j["ScreenFastCodec"] = m_screenFastCodec;
+    j["ScreenBandwidthBudget"] = m_screenBandwidthBudget;
+    j["ChainPipelineStages"] = m_chainPipelineStages;
+    j["MaxAudioWorkers"] = m_maxAudioWorkers;
+    j["AudioCores"] = m_audioCores;
+    j["CaptureStream"] = m_captureStreamPath.toStdString();
     j["ExcludePlugins"] = json::array();
     for (auto& p : m_pluginexclude) {
         j["ExcludePlugins"].push_back(p.toStdString());
@@ -77,6 +116,31 @@ void Server::saveConfig() {
     fos.writeText(j.dump(4), false, false, "\n");
 }
 
+MemoryBlock Server::getCompressedPluginList(uint32& hash) {
+    std::lock_guard<std::mutex> lock(m_pluginListCacheMtx);
+    if (!m_pluginListCacheValid) {
+        String list;
+        for (auto& plugin : m_pluginlist.getTypes()) {
+            list << Worker::getStringFrom(plugin) << "\n";
+        }
+        m_pluginListHash = (uint32)list.hashCode();
+        MemoryOutputStream mos;
+        {
+            GZIPCompressorOutputStream gz(&mos);
+            gz.write(list.getCharPointer(), (size_t)list.length());
+        }
+        m_pluginListCache = mos.getMemoryBlock();
+        m_pluginListCacheValid = true;
+    }
+    hash = m_pluginListHash;
+    return m_pluginListCache;
+}
+
+void Server::invalidatePluginListCache() {
+    std::lock_guard<std::mutex> lock(m_pluginListCacheMtx);
+    m_pluginListCacheValid = false;
+}
+
 void Server::loadKnownPluginList() {
     File file(KNOWN_PLUGINS_FILE);
     if (file.exists()) {
@@ -86,6 +150,7 @@ void Server::loadKnownPluginList() {
 }
 
 void Server::saveKnownPluginList() {
+    invalidatePluginListCache();
     File file(KNOWN_PLUGINS_FILE);
     auto xml = m_pluginlist.createXml();
     xml->writeTo(file);
@@ -102,6 +167,7 @@ Server::~Server() {
 
 void Server::shutdown() {
     m_masterSocket.close();
+    m_discoveryResponder.reset();
     for (auto& w : m_workers) {
         logln("shutting down worker, isRunning=" << (int)w->isThreadRunning());
         w->shutdown();
@@ -161,20 +227,25 @@ void Server::addPlugins(const std::vector<String>& names, std::function<void(boo
     }).detach();
 }
 
-bool Server::scanNextPlugin(PluginDirectoryScanner& scanner, String& name) {
-    std::mutex mtx;
-    std::condition_variable cv;
-    bool hasNext = false;
-    bool done = false;
-    MessageManager::callAsync([this, &mtx, &cv, &scanner, &name, &hasNext, &done] {
-        std::lock_guard<std::mutex> lock(mtx);
-        hasNext = scanner.scanNextFile(true, name);
-        done = true;
-        cv.notify_one();
-    });
-    std::unique_lock<std::mutex> lock(mtx);
-    cv.wait(lock, [&done] { return done; });
-    return hasNext;
+bool Server::scanPlugin(const String& id, const String& format) {
+    std::unique_ptr<AudioPluginFormat> fmt;
+    if (!format.compare("AudioUnit")) {
+        fmt = std::make_unique<AudioUnitPluginFormat>();
+    } else if (!format.compare("VST3")) {
+        fmt = std::make_unique<VST3PluginFormat>();
+    } else {
+        return false;
+    }
+    KnownPluginList plist;
+    OwnedArray<PluginDescription> results;
+    plist.scanAndAddFile(id, true, results, *fmt);
+    if (results.isEmpty()) {
+        return false;
+    }
+    if (auto xml = plist.createXml()) {
+        std::cout << xml->toString().toStdString() << std::endl;
+    }
+    return true;
 }
 
 void Server::scanForPlugins() {
@@ -193,25 +264,76 @@ void Server::scanForPlugins(const std::vector<String>& include) {
 
     std::set<String> neverSeenList = m_pluginexclude;
 
+    // Collect the files to scan, then fan out to a pool of sandboxed scanner processes: a
+    // crashing plugin takes down its child process instead of the server and a cold scan of many
+    // plugins runs in parallel.
+    struct ScanJob {
+        String id;
+        String format;
+    };
+    std::vector<ScanJob> jobs;
     for (auto& fmt : fmts) {
-        PluginDirectoryScanner scanner(m_pluginlist, *fmt, fmt->getDefaultLocationsToSearch(), true,
-                                       File(DEAD_MANS_FILE));
-        bool hasNext = true;
-        while (hasNext) {
-            auto name = scanner.getNextPluginFileThatWillBeScanned();
-            if (shouldExclude(name, include)) {
-                dbgln("  (skipping: " << name << ")");
-                hasNext = scanner.skipNextFile();
-            } else {
-                logln("  scanning: " << name);
-                getApp().setSplashInfo(String("Scanning plugin ") + name + "...");
-                hasNext = scanNextPlugin(scanner, name);
-                saveKnownPluginList();
+        for (auto& id : fmt->searchPathsForPlugins(fmt->getDefaultLocationsToSearch(), true)) {
+            if (shouldExclude(id, include)) {
+                dbgln("  (skipping: " << id << ")");
+            } else if (!m_pluginlist.isListingUpToDate(id, *fmt) &&
+                       !m_pluginlist.getBlacklistedFiles().contains(id)) {
+                jobs.push_back({id, fmt->getName()});
             }
-            neverSeenList.erase(name);
+            neverSeenList.erase(id);
+        }
+    }
+
+    if (!jobs.empty()) {
+        auto exe = File::getSpecialLocation(File::currentExecutableFile).getFullPathName();
+        std::atomic<size_t> jobIdx{0};
+        std::mutex listMtx;
+        int numScanned = 0;
+        int numWorkers = jlimit(2, 8, (int)std::thread::hardware_concurrency());
+        std::vector<std::thread> pool;
+        for (int i = 0; i < numWorkers; i++) {
+            pool.emplace_back([this, &jobs, &jobIdx, &listMtx, &exe] {
+                size_t idx;
+                while ((idx = jobIdx.fetch_add(1)) < jobs.size()) {
+                    auto& job = jobs[idx];
+                    logln("  scanning: " << job.id);
+                    getApp().setSplashInfo(String("Scanning plugin ") + job.id + "...");
+                    ChildProcess proc;
+                    StringArray args = {exe, "-scan", job.id, "-fmt", job.format};
+                    bool ok = false;
+                    if (proc.start(args)) {
+                        if (proc.waitForProcessToFinish(60000)) {
+                            if (proc.getExitCode() == 0) {
+                                if (auto xml = XmlDocument::parse(proc.readAllProcessOutput())) {
+                                    KnownPluginList results;
+                                    results.recreateFromXml(*xml);
+                                    std::lock_guard<std::mutex> lock(listMtx);
+                                    for (auto& t : results.getTypes()) {
+                                        m_pluginlist.addType(t);
+                                        ok = true;
+                                    }
+                                    // persist progress every few results instead of rewriting
+                                    // the whole XML per file
+                                    if (++numScanned % 10 == 0) {
+                                        saveKnownPluginList();
+                                    }
+                                }
+                            }
+                        } else {
+                            logln("  scan of " << job.id << " timed out, killing the scanner");
+                            proc.kill();
+                        }
+                    }
+                    if (!ok) {
+                        logln("  failed: " << job.id);
+                        std::lock_guard<std::mutex> lock(listMtx);
+                        m_pluginlist.addToBlacklist(job.id);
+                    }
+                }
+            });
         }
-        for (auto& f : scanner.getFailedFiles()) {
-            m_pluginlist.addToBlacklist(f);
+        for (auto& t : pool) {
+            t.join();
         }
     }
 
@@ -241,29 +363,40 @@ void Server::scanForPlugins(const std::vector<String>& include) {
 }
 
 void Server::run() {
-    logln("scanning for plugins...");
-    scanForPlugins();
-    saveConfig();
-    saveKnownPluginList();
-
-    getApp().hideSplashWindow();
+    // Serve the cached plugin list right away and rescan in the background: the incremental scan
+    // only touches plugins whose files changed since the last run, so a warm restart accepts
+    // clients immediately while a cold scan fills the list as it goes.
+    std::thread([this] {
+        logln("scanning for plugins...");
+        scanForPlugins();
+        saveConfig();
+        saveKnownPluginList();
+        getApp().hideSplashWindow();
+    }).detach();
 
     setsockopt(m_masterSocket.getRawSocketHandle(), SOL_SOCKET, SO_NOSIGPIPE, nullptr, 0);
 
     if (m_masterSocket.createListener(m_port + m_id, m_host)) {
         dbgln("server started: ID=" << m_id << ", PORT=" << m_port + m_id);
+        m_discoveryResponder = std::make_unique<DiscoveryResponder>(*this);
+        m_discoveryResponder->startThread();
+        m_metricsResponder = std::make_unique<MetricsResponder>(*this);
+        m_metricsResponder->startThread();
         while (!currentThreadShouldExit()) {
             auto* clnt = m_masterSocket.waitForNextConnection();
             if (nullptr != clnt) {
                 dbgln("new client " << clnt->getHostName());
-                m_workers.emplace_back(std::make_unique<Worker>(clnt));
-                m_workers.back()->startThread();
-                // lazy cleanup
                 std::shared_ptr<WorkerList> deadWorkers = std::make_shared<WorkerList>();
-                for (auto it = m_workers.begin(); it < m_workers.end(); it++) {
-                    if (!(*it)->isThreadRunning()) {
-                        deadWorkers->push_back(std::move(*it));
-                        m_workers.erase(it);
+                {
+                    std::lock_guard<std::mutex> lock(m_workersMtx);
+                    m_workers.emplace_back(std::make_unique<Worker>(clnt));
+                    m_workers.back()->startThread();
+                    // lazy cleanup
+                    for (auto it = m_workers.begin(); it < m_workers.end(); it++) {
+                        if (!(*it)->isThreadRunning()) {
+                            deadWorkers->push_back(std::move(*it));
+                            m_workers.erase(it);
+                        }
                     }
                 }
                 MessageManager::callAsync([deadWorkers] { deadWorkers->clear(); });
@@ -274,4 +407,88 @@ void Server::run() {
     }
 }
 
+void Server::DiscoveryResponder::run() {
+    DatagramSocket sock;
+    // several server instances on one host share the discovery port
+    int opt = 1;
+    setsockopt(sock.getRawSocketHandle(), SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    if (!sock.bindToPort(DEFAULT_DISCOVERY_PORT)) {
+        logln("unable to bind discovery port " << DEFAULT_DISCOVERY_PORT);
+        return;
+    }
+    while (!currentThreadShouldExit()) {
+        if (sock.waitUntilReady(true, 500) < 1) {
+            continue;
+        }
+        uint32 magic = 0;
+        String senderHost;
+        int senderPort = 0;
+        if (sock.read(&magic, sizeof(magic), false, senderHost, senderPort) != sizeof(magic) ||
+            magic != DISCOVERY_QUERY) {
+            continue;
+        }
+        json j = m_server.getLoadInfo(nullptr);
+        j["id"] = m_server.m_id;
+        j["port"] = m_server.m_port + m_server.m_id;
+        j["name"] = SystemStats::getComputerName().toStdString();
+        auto reply = j.dump();
+        sock.write(senderHost, senderPort, reply.data(), static_cast<int>(reply.length()));
+    }
+}
+
+void Server::MetricsResponder::run() {
+    setsockopt(m_socket.getRawSocketHandle(), SOL_SOCKET, SO_NOSIGPIPE, nullptr, 0);
+    int port = DEFAULT_METRICS_PORT + m_server.m_id;
+    if (!m_socket.createListener(port, m_server.m_host)) {
+        logln("unable to create metrics listener on port " << port);
+        return;
+    }
+    while (!currentThreadShouldExit()) {
+        std::unique_ptr<StreamingSocket> clnt(m_socket.waitForNextConnection());
+        if (nullptr == clnt) {
+            continue;
+        }
+        // drain whatever request came in, the dump is the answer to everything
+        char buf[512];
+        while (clnt->waitUntilReady(true, 10) > 0 && clnt->read(buf, sizeof(buf), false) == sizeof(buf)) {
+        }
+        auto j = Metrics::dump();
+        auto load = m_server.getLoadInfo(nullptr);
+        j["id"] = m_server.m_id;
+        j["workers"] = load["workers"];
+        j["procTimeMs"] = load["procTimeMs"];
+        auto body = j.dump();
+        String hdr;
+        hdr << "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: "
+            << static_cast<int>(body.length()) << "\r\nConnection: close\r\n\r\n";
+        clnt->write(hdr.toRawUTF8(), static_cast<int>(hdr.getNumBytesAsUTF8()));
+        clnt->write(body.data(), static_cast<int>(body.length()));
+    }
+}
+
+json Server::getLoadInfo(const Worker* exclude) {
+    std::lock_guard<std::mutex> lock(m_workersMtx);
+    int workers = 0;
+    double procTimeMs = 0.0;
+    for (auto& w : m_workers) {
+        if (w.get() == exclude || !w->isThreadRunning()) {
+            continue;
+        }
+        workers++;
+        procTimeMs += w->getChainProcTimeMs();
+    }
+    return {{"workers", workers}, {"procTimeMs", procTimeMs}};
+}
+
+int Server::getNumRunningWorkers(const Worker* exclude) {
+    std::lock_guard<std::mutex> lock(m_workersMtx);
+    int workers = 0;
+    for (auto& w : m_workers) {
+        if (w.get() != exclude && w->isThreadRunning()) {
+            workers++;
+        }
+    }
+    return workers;
+}
+
 }  // namespace e47
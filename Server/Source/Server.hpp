@@ -13,6 +13,7 @@
 #include "Defaults.hpp"
 #include "ProcessorChain.hpp"
 
+#include <mutex>
 #include <set>
 #include <thread>
 
@@ -35,15 +36,39 @@ class Server : public Thread {
     void setScreenQuality(float q) { m_screenJpgQuality = q; }
     bool getScreenDiffDetection() const { return m_screenDiffDetection; }
     void setScreenDiffDetection(bool b) { m_screenDiffDetection = b; }
+    bool getScreenFastCodec() const { return m_screenFastCodec; }
+    void setScreenFastCodec(bool b) { m_screenFastCodec = b; }
+    int getScreenBandwidthBudget() const { return m_screenBandwidthBudget; }
+    void setScreenBandwidthBudget(int kbPerSec) { m_screenBandwidthBudget = kbPerSec; }
+    int getChainPipelineStages() const { return m_chainPipelineStages; }
+    void setChainPipelineStages(int n) { m_chainPipelineStages = n; }
+    int getMaxAudioWorkers() const { return m_maxAudioWorkers; }
+    void setMaxAudioWorkers(int n) { m_maxAudioWorkers = n; }
+    int getAudioCores() const { return m_audioCores; }
+    void setAudioCores(int n) { m_audioCores = n; }
+    const String& getCaptureStreamPath() const { return m_captureStreamPath; }
+    void setCaptureStreamPath(const String& p) { m_captureStreamPath = p; }
     void run();
+    // load metric for the probe handshake: active workers and the audio time the chains spend
+    // per block, so clients can place new chains on the least loaded server of a group
+    json getLoadInfo(const Worker* exclude);
+    // number of connected clients, used by the admission check in Worker::run
+    int getNumRunningWorkers(const Worker* exclude);
     const KnownPluginList& getPluginList() const { return m_pluginlist; }
     KnownPluginList& getPluginList() { return m_pluginlist; }
+    // serialized and deflated plugin list, cached per list revision and shared by all workers
+    MemoryBlock getCompressedPluginList(uint32& hash);
+    void invalidatePluginListCache();
     bool shouldExclude(const String& name);
     bool shouldExclude(const String& name, const std::vector<String>& include);
     auto& getExcludeList() { return m_pluginexclude; }
     void addPlugins(const std::vector<String>& names, std::function<void(bool)> fn);
     void saveKnownPluginList();
 
+    // entry point of the sandboxed scanner processes, scans one plugin and dumps the result to
+    // stdout as XML
+    static bool scanPlugin(const String& id, const String& format);
+
   private:
     String m_host;
     int m_port = DEFAULT_SERVER_PORT;
@@ -51,14 +76,58 @@ class Server : public Thread {
     StreamingSocket m_masterSocket;
     using WorkerList = std::vector<std::unique_ptr<Worker>>;
     WorkerList m_workers;
+    std::mutex m_workersMtx;  // workers answer load probes while the accept loop mutates the list
     KnownPluginList m_pluginlist;
+    MemoryBlock m_pluginListCache;
+    uint32 m_pluginListHash = 0;
+    bool m_pluginListCacheValid = false;
+    std::mutex m_pluginListCacheMtx;
     std::set<String> m_pluginexclude;
     bool m_enableAU = true;
     bool m_enableVST = true;
     float m_screenJpgQuality = 0.9;
     bool m_screenDiffDetection = true;
+    bool m_screenFastCodec = true;    // compress raw tiles instead of PNG encoding them
+    int m_screenBandwidthBudget = 0;  // per editor screen stream budget in KB/s, 0 = unlimited
+    int m_chainPipelineStages = 0;  // 0/1 = sequential processing
+    int m_maxAudioWorkers = 0;      // 0 = unlimited, otherwise new clients get rejected at the cap
+    int m_audioCores = 0;           // 0 = no pinning, otherwise cores reserved for audio threads
+    String m_captureStreamPath;     // path prefix for stream captures (see StreamCapture), empty = off
+
+    // Answers discovery broadcasts with id, port, name and the current load metric, so clients
+    // can list reachable servers sorted by latency and load without a hand-maintained list.
+    class DiscoveryResponder : public Thread {
+      public:
+        DiscoveryResponder(Server& srv) : Thread("DiscoveryResponder"), m_server(srv) {}
+        ~DiscoveryResponder() { stopThread(1000); }
+        void run() override;
+
+      private:
+        Server& m_server;
+    };
+    friend DiscoveryResponder;
+
+    std::unique_ptr<DiscoveryResponder> m_discoveryResponder;
+
+    // Serves the metrics dump (see Metrics::dump) as json over HTTP on the metrics port, one
+    // request per connection, so health graphs just scrape http://host:port/.
+    class MetricsResponder : public Thread {
+      public:
+        MetricsResponder(Server& srv) : Thread("MetricsResponder"), m_server(srv) {}
+        ~MetricsResponder() {
+            m_socket.close();
+            stopThread(1000);
+        }
+        void run() override;
+
+      private:
+        Server& m_server;
+        StreamingSocket m_socket;
+    };
+    friend MetricsResponder;
+
+    std::unique_ptr<MetricsResponder> m_metricsResponder;
 
-    bool scanNextPlugin(PluginDirectoryScanner& scanner, String& name);
     void scanForPlugins();
     void scanForPlugins(const std::vector<String>& include);
     void loadKnownPluginList();
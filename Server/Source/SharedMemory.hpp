@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#ifndef SharedMemory_hpp
+#define SharedMemory_hpp
+
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+namespace e47 {
+
+/*
+ * Single-producer/single-consumer ring of fixed-size slots in a POSIX shared memory region, used
+ * as a zero-copy audio transport when client and server run on the same host. One ring per
+ * direction. The consumer is signalled through a named semaphore instead of a socket poll loop.
+ */
+class SharedMemoryRing {
+  public:
+    struct hdr_t {
+        std::atomic<uint64_t> readPos;
+        std::atomic<uint64_t> writePos;
+        uint32_t slotSize;
+        uint32_t numSlots;
+    };
+
+    ~SharedMemoryRing() { close(); }
+
+    // The creating side (the plugin client) sizes the ring. Slots are fixed size, a block that
+    // does not fit is a hard error on the write side.
+    bool create(const String& name, uint32_t slotSize, uint32_t numSlots) {
+        m_name = name;
+        m_owner = true;
+        m_closing = false;
+        shm_unlink(m_name.toRawUTF8());  // clean up leftovers from a crashed instance
+        sem_unlink(getSemName().toRawUTF8());
+        m_fd = shm_open(m_name.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (m_fd < 0) {
+            return false;
+        }
+        m_size = sizeof(hdr_t) + static_cast<size_t>(slotSize + sizeof(uint32_t)) * numSlots;
+        if (ftruncate(m_fd, static_cast<off_t>(m_size)) != 0) {
+            close();
+            return false;
+        }
+        if (!map()) {
+            close();
+            return false;
+        }
+        m_hdr->readPos = 0;
+        m_hdr->writePos = 0;
+        m_hdr->slotSize = slotSize;
+        m_hdr->numSlots = numSlots;
+        m_sem = sem_open(getSemName().toRawUTF8(), O_CREAT, 0600, 0);
+        if (m_sem == SEM_FAILED) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // The other side attaches to an existing ring.
+    bool open(const String& name) {
+        m_name = name;
+        m_owner = false;
+        m_closing = false;
+        m_fd = shm_open(m_name.toRawUTF8(), O_RDWR, 0600);
+        if (m_fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(hdr_t)) {
+            close();
+            return false;
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        if (!map()) {
+            close();
+            return false;
+        }
+        m_sem = sem_open(getSemName().toRawUTF8(), 0);
+        if (m_sem == SEM_FAILED) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return nullptr != m_hdr; }
+    uint32_t getSlotSize() const { return nullptr != m_hdr ? m_hdr->slotSize : 0; }
+
+    // Returns the payload area of the next free slot or nullptr if the ring is full.
+    char* beginWrite() {
+        if (nullptr == m_hdr || m_hdr->writePos - m_hdr->readPos >= m_hdr->numSlots) {
+            return nullptr;
+        }
+        return slot(m_hdr->writePos % m_hdr->numSlots) + sizeof(uint32_t);
+    }
+
+    void commitWrite(uint32_t size) {
+        auto* s = slot(m_hdr->writePos % m_hdr->numSlots);
+        memcpy(s, &size, sizeof(size));
+        m_hdr->writePos++;
+        sem_post(m_sem);
+    }
+
+    // Returns the payload of the next filled slot or nullptr on timeout/shutdown. The slot stays
+    // valid until commitRead.
+    const char* beginRead(uint32_t& size, int timeoutMilliseconds) {
+        if (nullptr == m_hdr) {
+            return nullptr;
+        }
+        // sem_timedwait does not exist on macOS, poll with a short sleep instead
+        auto until = Time::getMillisecondCounterHiRes() + timeoutMilliseconds;
+        while (sem_trywait(m_sem) != 0) {
+            if (m_closing || Time::getMillisecondCounterHiRes() > until) {
+                return nullptr;
+            }
+            usleep(100);
+        }
+        if (m_hdr->readPos >= m_hdr->writePos) {
+            return nullptr;
+        }
+        auto* s = slot(m_hdr->readPos % m_hdr->numSlots);
+        memcpy(&size, s, sizeof(size));
+        return s + sizeof(uint32_t);
+    }
+
+    void commitRead() { m_hdr->readPos++; }
+
+    void close() {
+        m_closing = true;
+        if (nullptr != m_base && m_base != MAP_FAILED) {
+            munmap(m_base, m_size);
+        }
+        m_base = nullptr;
+        m_hdr = nullptr;
+        if (m_fd > -1) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        if (m_sem != SEM_FAILED && nullptr != m_sem) {
+            sem_close(m_sem);
+            m_sem = SEM_FAILED;
+        }
+        if (m_owner && m_name.isNotEmpty()) {
+            shm_unlink(m_name.toRawUTF8());
+            sem_unlink(getSemName().toRawUTF8());
+        }
+    }
+
+  private:
+    String m_name;
+    bool m_owner = false;
+    int m_fd = -1;
+    size_t m_size = 0;
+    void* m_base = nullptr;
+    hdr_t* m_hdr = nullptr;
+    sem_t* m_sem = SEM_FAILED;
+    std::atomic_bool m_closing{false};
+
+    String getSemName() const { return m_name + ".sem"; }
+
+    bool map() {
+        m_base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (m_base == MAP_FAILED) {
+            m_base = nullptr;
+            return false;
+        }
+        m_hdr = static_cast<hdr_t*>(m_base);
+        return true;
+    }
+
+    char* slot(uint64_t idx) {
+        return static_cast<char*>(m_base) + sizeof(hdr_t) + idx * (m_hdr->slotSize + sizeof(uint32_t));
+    }
+};
+
+}  // namespace e47
+
+#endif /* SharedMemory_hpp */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020 Andreas Pohl
+ * Licensed under MIT (https://github.com/apohl79/audiogridder/blob/master/COPYING)
+ *
+ * Author: Andreas Pohl
+ */
+
+#ifndef StreamCapture_hpp
+#define StreamCapture_hpp
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+namespace e47 {
+
+/*
+ * Records the raw audio request stream (headers, samples, MIDI, position info) to a memory-mapped
+ * file, so a performance problem can be replayed offline without the DAW and the project that
+ * produced it (see Replay). The file grows in large chunks via ftruncate/mmap, the per-block cost
+ * on the capture side is a single memcpy and no syscalls in the steady state. Frames are stored
+ * in the plain TCP wire layout regardless of the negotiated transport.
+ */
+class StreamCapture {
+  public:
+    static constexpr uint32 MAGIC = 0x41474341;  // "AGCA"
+    static constexpr int VERSION = 1;
+
+    struct FileHeader {
+        uint32 magic;
+        int version;
+        int channels;
+        double rate;
+        int samplesPerBlock;
+        uint64 numFrames;
+    };
+
+    ~StreamCapture() { close(); }
+
+    bool open(const String& path, int channels, double rate, int samplesPerBlock) {
+        m_fd = ::open(File(path).getFullPathName().toRawUTF8(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0) {
+            return false;
+        }
+        if (!remap(GROW_CHUNK)) {
+            close();
+            return false;
+        }
+        FileHeader hdr = {MAGIC, VERSION, channels, rate, samplesPerBlock, 0};
+        memcpy(m_base, &hdr, sizeof(hdr));
+        m_offset = sizeof(hdr);
+        return true;
+    }
+
+    bool isOpen() const { return nullptr != m_base; }
+
+    // Returns a pointer to size writable bytes for the next frame or nullptr when growing the
+    // file failed, the frame is skipped in that case.
+    char* beginFrame(size_t size) {
+        if (nullptr == m_base) {
+            return nullptr;
+        }
+        if (m_offset + sizeof(uint32) + size > m_mapped && !remap(m_offset + sizeof(uint32) + size)) {
+            return nullptr;
+        }
+        return m_base + m_offset + sizeof(uint32);
+    }
+
+    void commitFrame(size_t size) {
+        auto size32 = static_cast<uint32>(size);
+        memcpy(m_base + m_offset, &size32, sizeof(size32));
+        m_offset += sizeof(size32) + size;
+        m_frames++;
+    }
+
+    void close() {
+        if (nullptr != m_base) {
+            // finalize the header and trim the file to the bytes actually written
+            reinterpret_cast<FileHeader*>(m_base)->numFrames = m_frames;
+            munmap(m_base, m_mapped);
+            m_base = nullptr;
+        }
+        if (m_fd > -1) {
+            if (ftruncate(m_fd, static_cast<off_t>(m_offset)) != 0) {
+                // the capture stays readable, it just carries trailing zeros
+            }
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_mapped = 0;
+        m_offset = 0;
+        m_frames = 0;
+    }
+
+  private:
+    static constexpr size_t GROW_CHUNK = 64 * 1024 * 1024;
+
+    int m_fd = -1;
+    char* m_base = nullptr;
+    size_t m_mapped = 0;
+    size_t m_offset = 0;
+    uint64 m_frames = 0;
+
+    bool remap(size_t minCapacity) {
+        size_t capacity = m_mapped;
+        while (capacity < minCapacity) {
+            capacity += GROW_CHUNK;
+        }
+        if (nullptr != m_base) {
+            munmap(m_base, m_mapped);
+            m_base = nullptr;
+        }
+        if (ftruncate(m_fd, static_cast<off_t>(capacity)) != 0) {
+            return false;
+        }
+        void* p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        m_base = static_cast<char*>(p);
+        m_mapped = capacity;
+        return true;
+    }
+};
+
+// Read side: maps a capture read-only and iterates its frames, rewindable for looped replays.
+class CaptureReader {
+  public:
+    ~CaptureReader() { close(); }
+
+    bool open(const String& path) {
+        m_fd = ::open(File(path).getFullPathName().toRawUTF8(), O_RDONLY);
+        if (m_fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StreamCapture::FileHeader)) {
+            close();
+            return false;
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (p == MAP_FAILED) {
+            close();
+            return false;
+        }
+        m_base = static_cast<const char*>(p);
+        memcpy(&m_hdr, m_base, sizeof(m_hdr));
+        if (m_hdr.magic != StreamCapture::MAGIC || m_hdr.version != StreamCapture::VERSION) {
+            close();
+            return false;
+        }
+        rewind();
+        return true;
+    }
+
+    bool isOpen() const { return nullptr != m_base; }
+    const StreamCapture::FileHeader& getHeader() const { return m_hdr; }
+
+    // Returns the next frame or nullptr at the end of the capture.
+    const char* nextFrame(uint32& size) {
+        if (nullptr == m_base || m_frame >= m_hdr.numFrames || m_offset + sizeof(uint32) > m_size) {
+            return nullptr;
+        }
+        memcpy(&size, m_base + m_offset, sizeof(size));
+        if (m_offset + sizeof(uint32) + size > m_size) {
+            return nullptr;  // truncated capture
+        }
+        const char* frame = m_base + m_offset + sizeof(uint32);
+        m_offset += sizeof(uint32) + size;
+        m_frame++;
+        return frame;
+    }
+
+    void rewind() {
+        m_offset = sizeof(StreamCapture::FileHeader);
+        m_frame = 0;
+    }
+
+    void close() {
+        if (nullptr != m_base) {
+            munmap(const_cast<char*>(m_base), m_size);
+            m_base = nullptr;
+        }
+        if (m_fd > -1) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_size = 0;
+    }
+
+  private:
+    int m_fd = -1;
+    const char* m_base = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+    uint64 m_frame = 0;
+    StreamCapture::FileHeader m_hdr = {};
+};
+
+}  // namespace e47
+
+#endif /* StreamCapture_hpp */
@@ -11,6 +11,15 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "App.hpp"
 
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #if (JUCE_DEBUG && !JUCE_DISABLE_ASSERTIONS)
 #define dbgln(M)                                                                                \
     JUCE_BLOCK_WITH_FORCED_SEMICOLON(String __str; __str << "[" << (uint64_t)this << "] " << M; \
@@ -29,6 +38,38 @@ namespace e47 {
 
 static App& getApp() { return *dynamic_cast<App*>(JUCEApplication::getInstance()); }
 
+// Scheduling groups for thread placement: audio threads on one side, the message thread and the
+// screen/housekeeping work on the other, so a burst of UI encoding never preempts a DSP thread.
+enum class ThreadGroup : int { AUDIO = 1, HOUSEKEEPING = 2 };
+
+#ifdef __APPLE__
+// macOS offers no hard core binding, but distinct affinity tags tell the scheduler to keep the
+// groups on separate cache domains, which is what the separation is really after.
+static void setCurrentThreadAffinity(ThreadGroup group, int /*audioCores*/) {
+    thread_affinity_policy_data_t policy = {static_cast<integer_t>(group)};
+    thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY,
+                      reinterpret_cast<thread_policy_t>(&policy), THREAD_AFFINITY_POLICY_COUNT);
+}
+#else
+// audio gets the upper audioCores cores exclusively, everything else stays on the lower ones
+static void setCurrentThreadAffinity(ThreadGroup group, int audioCores) {
+    int numCpus = SystemStats::getNumCpus();
+    audioCores = jlimit(1, numCpus - 1, audioCores);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (group == ThreadGroup::AUDIO) {
+        for (int c = numCpus - audioCores; c < numCpus; c++) {
+            CPU_SET(c, &set);
+        }
+    } else {
+        for (int c = 0; c < numCpus - audioCores; c++) {
+            CPU_SET(c, &set);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+#endif
+
 }  // namespace e47
 
 #endif /* Utils_hpp */
@@ -26,11 +26,82 @@ String Worker::getStringFrom(const PluginDescription& d) {
     return s;
 }
 
+String Worker::getPresets(AudioPluginInstance& proc) {
+    String presets;
+    bool first = true;
+    for (int i = 0; i < proc.getNumPrograms(); i++) {
+        if (first) {
+            first = false;
+        } else {
+            presets << "|";
+        }
+        presets << proc.getProgramName(i);
+    }
+    return presets;
+}
+
+// Fixed-layout packed parameter records for the ChainSnapshot reply, parsed by
+// Client::Parameter::fromStream. Plugins with thousands of parameters make the JSON
+// encode/decode of the legacy Parameters message take hundreds of milliseconds.
+void Worker::writeParameters(AudioPluginInstance& proc, MemoryOutputStream& mos) {
+    auto& params = proc.getParameters();
+    mos.writeInt(params.size());
+    for (auto& param : params) {
+        mos.writeInt(param->getParameterIndex());
+        mos.writeFloat(param->getDefaultValue());
+        mos.writeInt(param->getCategory());
+        mos.writeInt(param->getNumSteps());
+        uint8 flags = 0;
+        if (param->isBoolean()) {
+            flags |= 1;
+        }
+        if (param->isDiscrete()) {
+            flags |= 1 << 1;
+        }
+        if (param->isMetaParameter()) {
+            flags |= 1 << 2;
+        }
+        if (param->isOrientationInverted()) {
+            flags |= 1 << 3;
+        }
+        mos.writeByte(static_cast<char>(flags));
+        mos.writeString(param->getName(32));
+        mos.writeString(param->getLabel());
+    }
+}
+
+// JSON variant, kept for the legacy per-plugin AddPlugin exchange only.
+json Worker::getParametersJson(AudioPluginInstance& proc) {
+    json jparams = json::array();
+    for (auto& param : proc.getParameters()) {
+        json jparam = {{"idx", param->getParameterIndex()},        {"name", param->getName(32).toStdString()},
+                       {"defaultValue", param->getDefaultValue()}, {"category", param->getCategory()},
+                       {"label", param->getLabel().toStdString()}, {"numSteps", param->getNumSteps()},
+                       {"isBoolean", param->isBoolean()},          {"isDiscrete", param->isDiscrete()},
+                       {"isMeta", param->isMetaParameter()},       {"isOrientInv", param->isOrientationInverted()}};
+        jparams.push_back(jparam);
+    }
+    return jparams;
+}
+
 void Worker::run() {
+    if (int cores = getApp().getServer().getAudioCores()) {
+        setCurrentThreadAffinity(ThreadGroup::HOUSEKEEPING, cores);
+    }
     Handshake cfg;
     std::unique_ptr<StreamingSocket> sock;
     int len;
     len = m_client->read(&cfg, sizeof(cfg), true);
+    if (len > 0 && cfg.version == HANDSHAKE_PROBE) {
+        // a client scouting for the least loaded server, answer and close
+        Message<ServerLoad> msg;
+        auto j = getApp().getServer().getLoadInfo(this);
+        PLD(msg).setJson(j);
+        sendCmd(msg);
+        m_client->close();
+        signalThreadShouldExit();
+        return;
+    }
     if (len > 0) {
         dbgln("  version          = " << cfg.version);
         dbgln("  clientPort       = " << cfg.clientPort);
@@ -38,95 +109,150 @@ void Worker::run() {
         dbgln("  rate             = " << cfg.rate);
         dbgln("  samplesPerBlock  = " << cfg.samplesPerBlock);
         dbgln("  doublePrecission = " << static_cast<int>(cfg.doublePrecission));
+        dbgln("  flags            = " << cfg.flags);
+
+        m_clientVersion = cfg.version;
+
+        // admission control: past the configured limit a clear rejection beats degrading the
+        // clients that are already connected
+        int maxWorkers = getApp().getServer().getMaxAudioWorkers();
+        if (maxWorkers > 0 && getApp().getServer().getNumRunningWorkers(this) >= maxWorkers) {
+            logln("rejecting client " << m_client->getHostName() << ": server at capacity (" << maxWorkers
+                                      << " workers)");
+            Message<Result> msg;
+            PLD(msg).setResult(-1, "server at capacity, choose a different server");
+            sendCmd(msg);
+            m_client->close();
+            signalThreadShouldExit();
+            return;
+        }
+
+        bool resumed = false;
+        if (m_clientVersion > 5) {
+            // a returning client re-attaches to the chain parked by its previous connection
+            m_sessionToken = cfg.sessionToken;
+            resumed = m_sessionToken != 0 && m_audio.tryResume(m_sessionToken);
+        }
 
         // start audio processing
         sock = std::make_unique<StreamingSocket>();
         setsockopt(sock->getRawSocketHandle(), SOL_SOCKET, SO_NOSIGPIPE, nullptr, 0);
         if (sock->connect(m_client->getHostName(), cfg.clientPort)) {
-            m_audio.init(std::move(sock), cfg.channels, cfg.rate, cfg.samplesPerBlock, cfg.doublePrecission,
-                         [this] { /*m_client->close();*/ });
+            m_audio.init(std::move(sock), cfg.clientPort, cfg.channels, cfg.rate, cfg.samplesPerBlock,
+                         cfg.doublePrecission, cfg.flags, [this] { /*m_client->close();*/ });
             m_audio.startThread(Thread::realtimeAudioPriority);
         } else {
             logln("failed to establish audio connection to " << m_client->getHostName() << ":" << cfg.clientPort);
         }
 
         // start screen capturing
-        sock = std::make_unique<StreamingSocket>();
-        setsockopt(sock->getRawSocketHandle(), SOL_SOCKET, SO_NOSIGPIPE, nullptr, 0);
-        if (sock->connect(m_client->getHostName(), cfg.clientPort)) {
-            m_screen.init(std::move(sock));
+        if (cfg.flags & WIRE_MUX) {
+            // no extra connection, screen frames ride the command socket below command priority
+            m_screen.init(m_client.get(), &m_sendMtx);
             m_screen.startThread();
         } else {
-            logln("failed to establish screen connection to " << m_client->getHostName() << ":" << cfg.clientPort);
+            sock = std::make_unique<StreamingSocket>();
+            setsockopt(sock->getRawSocketHandle(), SOL_SOCKET, SO_NOSIGPIPE, nullptr, 0);
+            if (sock->connect(m_client->getHostName(), cfg.clientPort)) {
+                m_screen.init(std::move(sock));
+                m_screen.startThread();
+            } else {
+                logln("failed to establish screen connection to " << m_client->getHostName() << ":" << cfg.clientPort);
+            }
         }
 
-        // send list of plugins
-        auto& pluginList = getApp().getPluginList();
-        String list;
-        for (auto& plugin : pluginList.getTypes()) {
-            list += getStringFrom(plugin) + "\n";
+        // send the list of plugins, or just an empty acknowledgement when the client already
+        // holds the current revision
+        uint32 listHash = 0;
+        auto listData = getApp().getServer().getCompressedPluginList(listHash);
+        Message<PluginList> msgList;
+        PLD(msgList).allowCompression = false;  // the list blob is deflated already
+        if (cfg.version > 2 && cfg.pluginListHash == listHash && listHash != 0) {
+            PLD(msgList).setData(nullptr, 0);
+        } else {
+            PLD(msgList).setData(static_cast<const char*>(listData.getData()), (int)listData.getSize());
         }
-        Message<PluginList> msg;
-        PLD(msg).setString(list);
-        if (!msg.send(m_client.get())) {
+        if (!sendCmd(msgList)) {
             logln("failed to send plugin list");
             m_client->close();
             signalThreadShouldExit();
         }
 
-        // enter message loop
+        if (m_clientVersion > 5) {
+            // resume acknowledgement: the chain latency when the parked chain got re-attached,
+            // -1 for a fresh session that needs the full chain restore
+            sendResult(resumed ? m_audio.getLatencySamples() : -1);
+        }
+
+        // enter message loop, reusing a single message object so its buffer keeps the high
+        // water mark capacity instead of being reallocated for every command
+        Message<Any> msg;
         while (!currentThreadShouldExit() && nullptr != m_client && m_client->isConnected()) {
             MessageHelper::Error e;
-            auto msg = MessageFactory::getNextMessage(m_client.get(), &e);
-            if (nullptr != msg) {
-                switch (msg->getType()) {
+            if (MessageFactory::getNextMessage(m_client.get(), msg, &e)) {
+                switch (msg.getType()) {
                     case Quit::Type:
-                        handleMessage(Message<Any>::convert<Quit>(msg));
+                        dispatch<Quit>(msg);
                         break;
                     case AddPlugin::Type:
-                        handleMessage(Message<Any>::convert<AddPlugin>(msg));
+                        dispatch<AddPlugin>(msg);
                         break;
                     case DelPlugin::Type:
-                        handleMessage(Message<Any>::convert<DelPlugin>(msg));
+                        dispatch<DelPlugin>(msg);
                         break;
                     case EditPlugin::Type:
-                        handleMessage(Message<Any>::convert<EditPlugin>(msg));
+                        dispatch<EditPlugin>(msg);
                         break;
                     case HidePlugin::Type:
-                        handleMessage(Message<Any>::convert<HidePlugin>(msg));
+                        dispatch<HidePlugin>(msg);
                         break;
                     case Mouse::Type:
-                        handleMessage(Message<Any>::convert<Mouse>(msg));
+                        dispatch<Mouse>(msg);
                         break;
                     case Key::Type:
-                        handleMessage(Message<Any>::convert<Key>(msg));
+                        dispatch<Key>(msg);
                         break;
                     case GetPluginSettings::Type:
-                        handleMessage(Message<Any>::convert<GetPluginSettings>(msg));
+                        dispatch<GetPluginSettings>(msg);
                         break;
                     case BypassPlugin::Type:
-                        handleMessage(Message<Any>::convert<BypassPlugin>(msg));
+                        dispatch<BypassPlugin>(msg);
                         break;
                     case UnbypassPlugin::Type:
-                        handleMessage(Message<Any>::convert<UnbypassPlugin>(msg));
+                        dispatch<UnbypassPlugin>(msg);
                         break;
                     case ExchangePlugins::Type:
-                        handleMessage(Message<Any>::convert<ExchangePlugins>(msg));
+                        dispatch<ExchangePlugins>(msg);
                         break;
                     case RecentsList::Type:
-                        handleMessage(Message<Any>::convert<RecentsList>(msg));
+                        dispatch<RecentsList>(msg);
                         break;
                     case Preset::Type:
-                        handleMessage(Message<Any>::convert<Preset>(msg));
+                        dispatch<Preset>(msg);
                         break;
                     case ParameterValue::Type:
-                        handleMessage(Message<Any>::convert<ParameterValue>(msg));
+                        dispatch<ParameterValue>(msg);
                         break;
                     case GetParameterValue::Type:
-                        handleMessage(Message<Any>::convert<GetParameterValue>(msg));
+                        dispatch<GetParameterValue>(msg);
+                        break;
+                    case ChainSnapshot::Type:
+                        dispatch<ChainSnapshot>(msg);
+                        break;
+                    case ParameterValuesBatch::Type:
+                        dispatch<ParameterValuesBatch>(msg);
+                        break;
+                    case GetPresets::Type:
+                        dispatch<GetPresets>(msg);
+                        break;
+                    case GetParameters::Type:
+                        dispatch<GetParameters>(msg);
+                        break;
+                    case ProcTimes::Type:
+                        dispatch<ProcTimes>(msg);
                         break;
                     default:
-                        logln("unknown message type " << msg->getType());
+                        logln("unknown message type " << msg.getType());
                 }
             } else if (e != MessageHelper::E_TIMEOUT) {
                 break;
@@ -135,6 +261,10 @@ void Worker::run() {
     } else {
         logln("handshake error with client " << m_client->getHostName());
     }
+    if (!m_shutdown && m_sessionToken != 0 && m_audio.getSize() > 0) {
+        // the connection dropped without a Quit, keep the chain around for a quick resume
+        m_audio.park(m_sessionToken);
+    }
     shutdown();
     dbgln("command processor terminated");
 }
@@ -144,6 +274,7 @@ void Worker::shutdown() {
         return;
     }
     m_shutdown = true;
+    detachParamListener();
     if (m_shouldHideEditor) {
         m_screen.hideEditor();
     }
@@ -154,57 +285,47 @@ void Worker::shutdown() {
     signalThreadShouldExit();
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<Quit>> msg) { shutdown(); }
+void Worker::handleMessage(Message<Quit>& msg) {
+    // an explicit goodbye, the client is not coming back for this chain
+    m_sessionToken = 0;
+    shutdown();
+}
 
-void Worker::handleMessage(std::shared_ptr<Message<AddPlugin>> msg) {
-    auto id = pPLD(msg).getString();
+void Worker::handleMessage(Message<AddPlugin>& msg) {
+    auto id = PLD(msg).getString();
     logln("adding plugin " << id << "...");
     bool success = m_audio.addPlugin(id);
     logln("..." << (success ? "ok" : "failed"));
     if (!success) {
-        MessageFactory::sendResult(m_client.get(), -1);
+        sendResult(-1);
+        if (m_clientVersion > 2) {
+            // version 3+ clients pipeline the settings right behind AddPlugin, consume them
+            Message<PluginSettings> msgSettings;
+            msgSettings.read(m_client.get());
+        }
         return;
     }
     m_audio.addToRecentsList(id, m_client->getHostName());
     // send new updated latency samples back
-    if (!MessageFactory::sendResult(m_client.get(), m_audio.getLatencySamples())) {
+    if (!sendResult(m_audio.getLatencySamples())) {
         logln("failed to send result");
         m_client->close();
         return;
     }
     logln("sending presets...");
     auto proc = m_audio.getProcessor(m_audio.getSize() - 1);
-    String presets;
-    bool first = true;
-    for (int i = 0; i < proc->getNumPrograms(); i++) {
-        if (first) {
-            first = false;
-        } else {
-            presets << "|";
-        }
-        presets << proc->getProgramName(i);
-    }
     Message<Presets> msgPresets;
-    msgPresets.payload.setString(presets);
-    if (!msgPresets.send(m_client.get())) {
+    msgPresets.payload.setString(getPresets(*proc));
+    if (!sendCmd(msgPresets)) {
         logln("failed to send Presets message");
         m_client->close();
         return;
     }
     logln("...ok");
     logln("sending parameters...");
-    json jparams = json::array();
-    for (auto& param : proc->getParameters()) {
-        json jparam = {{"idx", param->getParameterIndex()},        {"name", param->getName(32).toStdString()},
-                       {"defaultValue", param->getDefaultValue()}, {"category", param->getCategory()},
-                       {"label", param->getLabel().toStdString()}, {"numSteps", param->getNumSteps()},
-                       {"isBoolean", param->isBoolean()},          {"isDiscrete", param->isDiscrete()},
-                       {"isMeta", param->isMetaParameter()},       {"isOrientInv", param->isOrientationInverted()}};
-        jparams.push_back(jparam);
-    }
     Message<Parameters> msgParams;
-    msgParams.payload.setJson(jparams);
-    if (!msgParams.send(m_client.get())) {
+    msgParams.payload.setJson(getParametersJson(*proc));
+    if (!sendCmd(msgParams)) {
         logln("failed to send Parameters message");
         m_client->close();
         return;
@@ -226,27 +347,52 @@ void Worker::handleMessage(std::shared_ptr<Message<AddPlugin>> msg) {
     logln("...ok");
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<DelPlugin>> msg) {
-    m_audio.delPlugin(pPLD(msg).getNumber());
+void Worker::handleMessage(Message<DelPlugin>& msg) {
+    m_audio.delPlugin(PLD(msg).getNumber());
     // send new updated latency samples back
-    MessageFactory::sendResult(m_client.get(), m_audio.getLatencySamples());
+    sendResult(m_audio.getLatencySamples());
+    if (m_clientVersion > 4) {
+        // removing a plugin can give the chain its double precision support back
+        Message<ChainPrecision> prec;
+        PLD(prec).setNumber(m_audio.supportsDoublePrecision() ? 1 : 0);
+        sendCmd(prec);
+    }
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<EditPlugin>> msg) {
-    auto proc = m_audio.getProcessor(pPLD(msg).getNumber());
+void Worker::handleMessage(Message<EditPlugin>& msg) {
+    auto proc = m_audio.getProcessor(PLD(msg).getNumber());
     if (nullptr != proc) {
         m_screen.showEditor(proc);
         m_shouldHideEditor = true;
+        // push value changes made in the remote UI to the client
+        detachParamListener();
+        m_paramListener.m_pluginIdx = PLD(msg).getNumber();
+        for (auto* param : proc->getParameters()) {
+            param->addListener(&m_paramListener);
+        }
+        m_editedProc = proc;
     }
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<HidePlugin>> msg) {
+void Worker::handleMessage(Message<HidePlugin>& msg) {
+    detachParamListener();
     m_screen.hideEditor();
     m_shouldHideEditor = false;
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<Mouse>> msg) {
-    auto ev = *pDATA(msg);
+void Worker::detachParamListener() {
+    if (nullptr != m_editedProc) {
+        for (auto* param : m_editedProc->getParameters()) {
+            param->removeListener(&m_paramListener);
+        }
+        m_editedProc.reset();
+    }
+}
+
+void Worker::handleMessage(Message<Mouse>& msg) {
+    // input means the user is looking, raise the screen frame rate
+    m_screen.noteUserActivity();
+    auto ev = *DATA(msg);
     MessageManager::callAsync([ev] {
         auto point = getApp().localPointToGlobal(Point<float>(ev.x, ev.y));
         uint64_t flags = 0;
@@ -263,10 +409,12 @@ void Worker::handleMessage(std::shared_ptr<Message<Mouse>> msg) {
     });
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<Key>> msg) {
-    MessageManager::callAsync([msg] {
-        auto* codes = pPLD(msg).getKeyCodes();
-        auto num = pPLD(msg).getKeyCount();
+void Worker::handleMessage(Message<Key>& msg) {
+    m_screen.noteUserActivity();
+    // copy the codes out, the payload buffer goes back to the pool when this returns
+    std::vector<uint16_t> codes(PLD(msg).getKeyCodes(), PLD(msg).getKeyCodes() + PLD(msg).getKeyCount());
+    MessageManager::callAsync([codes] {
+        auto num = static_cast<int>(codes.size());
         uint16_t key = 0;
         uint64_t flags = 0;
         for (int i = 0; i < num; i++) {
@@ -285,64 +433,178 @@ void Worker::handleMessage(std::shared_ptr<Message<Key>> msg) {
     });
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<GetPluginSettings>> msg) {
-    auto proc = m_audio.getProcessor(pPLD(msg).getNumber());
+void Worker::handleMessage(Message<GetPluginSettings>& msg) {
+    auto proc = m_audio.getProcessor(PLD(msg).getNumber());
     if (nullptr != proc) {
         MemoryBlock block;
         proc->getStateInformation(block);
         Message<PluginSettings> ret;
+        ret.payload.allowCompression = m_clientVersion > 3;
         ret.payload.setData(block.begin(), static_cast<int>(block.getSize()));
-        ret.send(m_client.get());
+        sendCmd(ret);
     }
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<BypassPlugin>> msg) {
-    auto proc = m_audio.getProcessor(pPLD(msg).getNumber());
+void Worker::handleMessage(Message<BypassPlugin>& msg) {
+    auto proc = m_audio.getProcessor(PLD(msg).getNumber());
     if (nullptr != proc) {
         proc->suspendProcessing(true);
     }
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<UnbypassPlugin>> msg) {
-    auto proc = m_audio.getProcessor(pPLD(msg).getNumber());
+void Worker::handleMessage(Message<UnbypassPlugin>& msg) {
+    auto proc = m_audio.getProcessor(PLD(msg).getNumber());
     if (nullptr != proc) {
         proc->suspendProcessing(false);
     }
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<ExchangePlugins>> msg) {
-    m_audio.exchangePlugins(pDATA(msg)->idxA, pDATA(msg)->idxB);
+void Worker::handleMessage(Message<ExchangePlugins>& msg) {
+    m_audio.exchangePlugins(DATA(msg)->idxA, DATA(msg)->idxB);
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<RecentsList>> msg) {
+void Worker::handleMessage(Message<RecentsList>& msg) {
     auto& recents = m_audio.getRecentsList(m_client->getHostName());
     String list;
     for (auto& r : recents) {
         list += getStringFrom(r) + "\n";
     }
-    pPLD(msg).setString(list);
-    msg->send(m_client.get());
+    PLD(msg).setString(list);
+    sendCmd(msg);
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<Preset>> msg) {
-    m_audio.getProcessor(pDATA(msg)->idx)->setCurrentProgram(pDATA(msg)->preset);
+void Worker::handleMessage(Message<Preset>& msg) {
+    m_audio.getProcessor(DATA(msg)->idx)->setCurrentProgram(DATA(msg)->preset);
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<ParameterValue>> msg) {
-    for (auto* p : m_audio.getProcessor(pDATA(msg)->idx)->getParameters()) {
-        if (pDATA(msg)->paramIdx == p->getParameterIndex()) {
-            p->setValue(pDATA(msg)->value);
+// The parameter index matches the array position for virtually every plugin, so try the direct
+// lookup first instead of scanning thousands of parameters per set.
+static void setParamValue(AudioPluginInstance& proc, int paramIdx, float value) {
+    auto& params = proc.getParameters();
+    if (paramIdx > -1 && paramIdx < params.size() && params[paramIdx]->getParameterIndex() == paramIdx) {
+        params[paramIdx]->setValue(value);
+        return;
+    }
+    for (auto* p : params) {
+        if (paramIdx == p->getParameterIndex()) {
+            p->setValue(value);
             return;
         }
     }
 }
 
-void Worker::handleMessage(std::shared_ptr<Message<GetParameterValue>> msg) {
+void Worker::handleMessage(Message<ParameterValue>& msg) {
+    auto proc = m_audio.getProcessor(DATA(msg)->idx);
+    if (nullptr != proc) {
+        setParamValue(*proc, DATA(msg)->paramIdx, DATA(msg)->value);
+    }
+}
+
+void Worker::handleMessage(Message<GetPresets>& msg) {
+    String presets;
+    auto proc = m_audio.getProcessor(PLD(msg).getNumber());
+    if (nullptr != proc) {
+        presets = getPresets(*proc);
+    }
+    Message<Presets> ret;
+    ret.payload.setString(presets);
+    sendCmd(ret);
+}
+
+void Worker::handleMessage(Message<ProcTimes>& msg) {
+    Message<ProcTimes> ret;
+    auto j = m_audio.getProcTimes();
+    PLD(ret).setJson(j);
+    sendCmd(ret);
+}
+
+void Worker::handleMessage(Message<GetParameters>& msg) {
+    MemoryOutputStream mos;
+    auto proc = m_audio.getProcessor(PLD(msg).getNumber());
+    if (nullptr != proc) {
+        writeParameters(*proc, mos);
+    } else {
+        mos.writeInt(0);
+    }
+    Message<ParametersPacked> ret;
+    PLD(ret).setData(static_cast<const char*>(mos.getData()), static_cast<int>(mos.getDataSize()));
+    sendCmd(ret);
+}
+
+void Worker::handleMessage(Message<ParameterValuesBatch>& msg) {
+    int count = 0;
+    auto* values = PLD(msg).getValues(count);
+    for (int i = 0; i < count; i++) {
+        auto proc = m_audio.getProcessor(values[i].idx);
+        if (nullptr != proc) {
+            setParamValue(*proc, values[i].paramIdx, values[i].value);
+        }
+    }
+}
+
+void Worker::handleMessage(Message<GetParameterValue>& msg) {
     Message<ParameterValue> ret;
-    DATA(ret)->idx = pDATA(msg)->idx;
-    DATA(ret)->paramIdx = pDATA(msg)->paramIdx;
-    DATA(ret)->value = m_audio.getParameterValue(pDATA(msg)->idx, pDATA(msg)->paramIdx);
-    ret.send(m_client.get());
+    DATA(ret)->idx = DATA(msg)->idx;
+    DATA(ret)->paramIdx = DATA(msg)->paramIdx;
+    DATA(ret)->value = m_audio.getParameterValue(DATA(msg)->idx, DATA(msg)->paramIdx);
+    sendCmd(ret);
+}
+
+void Worker::handleMessage(Message<ChainSnapshot>& msg) {
+    MemoryOutputStream mos;
+    if (*PLD(msg).size == 0) {
+        // state query for saving: pack the settings of every loaded plugin
+        int num = static_cast<int>(m_audio.getSize());
+        mos.writeInt(num);
+        for (int idx = 0; idx < num; idx++) {
+            auto proc = m_audio.getProcessor(idx);
+            MemoryBlock settings;
+            proc->getStateInformation(settings);
+            mos.writeInt(static_cast<int>(settings.getSize()));
+            mos.write(settings.getData(), settings.getSize());
+        }
+    } else {
+        // session restore: add all plugins of the chain in one go
+        MemoryInputStream mis(PLD(msg).data, static_cast<size_t>(*PLD(msg).size), false);
+        int num = mis.readInt();
+        logln("restoring chain snapshot with " << num << " plugins...");
+        mos.writeInt(num);
+        for (int i = 0; i < num; i++) {
+            auto id = mis.readString();
+            bool bypassed = mis.readBool();
+            int settingsSize = mis.readInt();
+            MemoryBlock settings;
+            if (settingsSize > 0) {
+                mis.readIntoMemoryBlock(settings, settingsSize);
+            }
+            logln("adding plugin " << id << "...");
+            bool success = m_audio.addPlugin(id);
+            logln("..." << (success ? "ok" : "failed"));
+            mos.writeBool(success);
+            if (!success) {
+                continue;
+            }
+            m_audio.addToRecentsList(id, m_client->getHostName());
+            auto proc = m_audio.getProcessor(m_audio.getSize() - 1);
+            if (settings.getSize() > 0) {
+                proc->setStateInformation(settings.getData(), static_cast<int>(settings.getSize()));
+            }
+            if (bypassed) {
+                proc->suspendProcessing(true);
+            }
+            // presets and parameter metadata are fetched lazily via GetPresets/GetParameters
+        }
+        mos.writeInt(m_audio.getLatencySamples());
+        // precision feedback, version 4 clients stop reading before this
+        mos.writeBool(m_audio.supportsDoublePrecision());
+        logln("...chain restored");
+    }
+    Message<ChainSnapshot> ret;
+    PLD(ret).setData(static_cast<const char*>(mos.getData()), static_cast<int>(mos.getDataSize()));
+    if (!sendCmd(ret)) {
+        logln("failed to send ChainSnapshot message");
+        m_client->close();
+    }
 }
 
 }  // namespace e47
@@ -27,30 +27,81 @@ class Worker : public Thread {
 
     void shutdown();
 
-    void handleMessage(std::shared_ptr<Message<Quit>> msg);
-    void handleMessage(std::shared_ptr<Message<AddPlugin>> msg);
-    void handleMessage(std::shared_ptr<Message<DelPlugin>> msg);
-    void handleMessage(std::shared_ptr<Message<EditPlugin>> msg);
-    void handleMessage(std::shared_ptr<Message<HidePlugin>> msg);
-    void handleMessage(std::shared_ptr<Message<Mouse>> msg);
-    void handleMessage(std::shared_ptr<Message<Key>> msg);
-    void handleMessage(std::shared_ptr<Message<GetPluginSettings>> msg);
-    void handleMessage(std::shared_ptr<Message<BypassPlugin>> msg);
-    void handleMessage(std::shared_ptr<Message<UnbypassPlugin>> msg);
-    void handleMessage(std::shared_ptr<Message<ExchangePlugins>> msg);
-    void handleMessage(std::shared_ptr<Message<RecentsList>> msg);
-    void handleMessage(std::shared_ptr<Message<Preset>> msg);
-    void handleMessage(std::shared_ptr<Message<ParameterValue>> msg);
-    void handleMessage(std::shared_ptr<Message<GetParameterValue>> msg);
+    // per worker share of the server load metric (see Server::getLoadInfo)
+    double getChainProcTimeMs() const { return m_audio.getAverageProcessTimeMs(); }
+
+    // the handlers get a typed view over the pooled message buffer, they must not hold on to
+    // the payload beyond their own scope
+    void handleMessage(Message<Quit>& msg);
+    void handleMessage(Message<AddPlugin>& msg);
+    void handleMessage(Message<DelPlugin>& msg);
+    void handleMessage(Message<EditPlugin>& msg);
+    void handleMessage(Message<HidePlugin>& msg);
+    void handleMessage(Message<Mouse>& msg);
+    void handleMessage(Message<Key>& msg);
+    void handleMessage(Message<GetPluginSettings>& msg);
+    void handleMessage(Message<BypassPlugin>& msg);
+    void handleMessage(Message<UnbypassPlugin>& msg);
+    void handleMessage(Message<ExchangePlugins>& msg);
+    void handleMessage(Message<RecentsList>& msg);
+    void handleMessage(Message<Preset>& msg);
+    void handleMessage(Message<ParameterValue>& msg);
+    void handleMessage(Message<GetParameterValue>& msg);
+    void handleMessage(Message<ChainSnapshot>& msg);
+    void handleMessage(Message<ParameterValuesBatch>& msg);
+    void handleMessage(Message<GetPresets>& msg);
+    void handleMessage(Message<GetParameters>& msg);
+    void handleMessage(Message<ProcTimes>& msg);
 
   private:
     std::unique_ptr<StreamingSocket> m_client;
+    int m_clientVersion = 0;
+    // handshake session token, zero when the client does not want its chain parked on a drop
+    uint32 m_sessionToken = 0;
     AudioWorker m_audio;
     ScreenWorker m_screen;
     bool m_shouldHideEditor = false;
     std::atomic_bool m_shutdown{false};
+    // serializes writes on the command socket, in mux mode the screen worker shares it and a
+    // chunk and a command reply must not interleave mid-message
+    std::mutex m_sendMtx;
+
+    template <typename T>
+    bool sendCmd(Message<T>& msg) {
+        std::lock_guard<std::mutex> lock(m_sendMtx);
+        return msg.send(m_client.get());
+    }
+
+    bool sendResult(int rc) {
+        std::lock_guard<std::mutex> lock(m_sendMtx);
+        return MessageFactory::sendResult(m_client.get(), rc);
+    }
+
+    template <typename T>
+    void dispatch(Message<Any>& msg) {
+        MessageView<T> view(msg);
+        handleMessage(view);
+    }
+
+    // forwards value changes of the edited plugin to the client through the screen channel
+    struct ParamValueListener : AudioProcessorParameter::Listener {
+        ParamValueListener(ScreenWorker& screen) : m_screen(screen) {}
+        void parameterValueChanged(int parameterIndex, float newValue) override {
+            m_screen.pushParameterChange(m_pluginIdx, parameterIndex, newValue);
+        }
+        void parameterGestureChanged(int, bool) override {}
+        ScreenWorker& m_screen;
+        int m_pluginIdx = 0;
+    };
+    ParamValueListener m_paramListener{m_screen};
+    std::shared_ptr<AudioPluginInstance> m_editedProc;
+
+    void detachParamListener();
 
-    String getStringFrom(const PluginDescription& d);
+    static String getStringFrom(const PluginDescription& d);
+    static String getPresets(AudioPluginInstance& proc);
+    static json getParametersJson(AudioPluginInstance& proc);
+    static void writeParameters(AudioPluginInstance& proc, MemoryOutputStream& mos);
 };
 
 }  // namespace e47